@@ -0,0 +1,113 @@
+/**
+ * @file progress-multi-bench.cc
+ * @brief Compares ProgressMulti with K separate Progress instances
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * Both sides track three metrics through the same four-level stack
+ * with granularity 1. Every level spans the whole range of its parent
+ * and has as many units as there are steps, so each step advances the
+ * root by one and invokes a callback. The program prints the cost of
+ * a step and the callbacks per step for each side, and exits with a
+ * non-zero code if the single instance is not cheaper.
+ */
+
+#include "progress.h"
+#include "progress-multi.h"
+#include <QElapsedTimer>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { METRICS = 3 };
+
+//! Keeps the callbacks from being optimized away.
+static volatile int64_t sink;
+//! Number of callbacks invoked.
+static int64_t signal_count;
+
+static bool multiSignal (
+        const int64_t * total_size, const int64_t * progress,
+        const QString &, void *, void *)
+{
+    sink = total_size[0] + progress[METRICS - 1];
+    ++signal_count;
+    return true;
+}
+
+static bool singleSignal (int64_t total_size, int64_t progress)
+{
+    sink = total_size + progress;
+    ++signal_count;
+    return true;
+}
+
+//! ns per step of a ProgressMulti tracking all metrics.
+static double benchMulti (int64_t steps)
+{
+    const int64_t size[METRICS] = { steps, steps, steps };
+    const int64_t one[METRICS] = { 1, 1, 1 };
+
+    ProgressMulti<METRICS> p;
+    p.setCallback (multiSignal);
+    p.init ("bench", size);
+    p.enter (size, "a", size);
+    p.enter (size, "b", size);
+    p.enter (size, "c", size);
+
+    signal_count = 0;
+    QElapsedTimer timer;
+    timer.start ();
+    for (int64_t i = 0; i < steps; ++i) {
+        p.step (one);
+    }
+    return (double)timer.nsecsElapsed () / steps;
+}
+
+//! ns per step of K Progress instances, one for each metric.
+static double benchSeparate (int64_t steps)
+{
+    Progress p[METRICS];
+    for (int k = 0; k < METRICS; ++k) {
+        p[k].setSimpleCallback (singleSignal);
+        p[k].init ("bench", steps);
+        p[k].enter (steps, "a", steps);
+        p[k].enter (steps, "b", steps);
+        p[k].enter (steps, "c", steps);
+    }
+
+    signal_count = 0;
+
+    QElapsedTimer timer;
+    timer.start ();
+    for (int64_t i = 0; i < steps; ++i) {
+        for (int k = 0; k < METRICS; ++k) {
+            p[k].step ();
+        }
+    }
+    return (double)timer.nsecsElapsed () / steps;
+}
+
+int main (int argc, char * argv[])
+{
+    int64_t steps = argc > 1 ? atoll (argv[1]) : 2000000;
+    if (steps <= 0) steps = 2000000;
+
+    // warm up, then measure
+    benchMulti (steps / 10);
+    benchSeparate (steps / 10);
+    double multi = benchMulti (steps);
+    double multi_signals = (double)signal_count / steps;
+    double separate = benchSeparate (steps);
+    double separate_signals = (double)signal_count / steps;
+
+    printf ("steps:                    %lld\n", (long long)steps);
+    printf ("ProgressMulti<%d>:         %8.2f ns/step, %.3f callbacks/step\n",
+            METRICS, multi, multi_signals);
+    printf ("%d x Progress:             %8.2f ns/step, %.3f callbacks/step\n",
+            METRICS, separate, separate_signals);
+    printf ("ratio (multi / separate): %8.3f\n", multi / separate);
+
+    return multi < separate ? 0 : 1;
+}
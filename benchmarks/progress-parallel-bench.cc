@@ -0,0 +1,110 @@
+/**
+ * @file progress-parallel-bench.cc
+ * @brief Scaling of ProgressParallel against a plain loop
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * The baseline is a single-threaded loop that calls the body over the
+ * whole range and reports nothing. ProgressParallel then processes the
+ * same range with 1, 2, 4, ... threads (up to the ideal thread count)
+ * while reporting to a Progress instance with granularity 1. For each
+ * count the program prints the time, the speed-up over the baseline
+ * and the efficiency (speed-up / threads); the scaling has to be read
+ * from a run on a machine with several cores. It exits with a non-zero
+ * code if a single thread costs more than 10% over the baseline.
+ */
+
+#include "progress.h"
+#include "progress-parallel.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <stdio.h>
+#include <stdlib.h>
+
+//! Keeps the work from being optimized away.
+static volatile uint64_t sink;
+
+//! Some arithmetic for each item (a few hundred ns).
+static bool body (int64_t begin, int64_t end, void *)
+{
+    uint64_t acc = 0;
+    for (int64_t i = begin; i < end; ++i) {
+        uint64_t x = (uint64_t)i;
+        for (int k = 0; k < 64; ++k) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+        acc += x;
+    }
+    sink = sink + acc;
+    return true;
+}
+
+static bool reportSignal (int64_t total_size, int64_t progress)
+{
+    sink = sink + (uint64_t)(total_size - progress);
+    return true;
+}
+
+//! ns for the whole range with a plain loop.
+static double benchBaseline (int64_t items)
+{
+    QElapsedTimer timer;
+    timer.start ();
+    body (0, items, NULL);
+    return (double)timer.nsecsElapsed ();
+}
+
+//! ns for the whole range with ProgressParallel.
+static double benchParallel (int64_t items, int threads)
+{
+    Progress p;
+    p.setSimpleCallback (reportSignal);
+    p.init ("bench", items);
+
+    ProgressParallel loop (body);
+    loop.setThreadCount (threads);
+
+    QElapsedTimer timer;
+    timer.start ();
+    loop.run (p, 0, items);
+    return (double)timer.nsecsElapsed ();
+}
+
+int main (int argc, char * argv[])
+{
+    int64_t items = argc > 1 ? atoll (argv[1]) : 4000000;
+    if (items <= 0) items = 4000000;
+    int max_threads = QThread::idealThreadCount ();
+    if (max_threads < 1) max_threads = 1;
+    QThreadPool * pool = QThreadPool::globalInstance ();
+    if (pool->maxThreadCount () < max_threads) {
+        pool->setMaxThreadCount (max_threads);
+    }
+
+    // warm up, then measure
+    benchBaseline (items / 10);
+    benchParallel (items / 10, max_threads);
+    double baseline = benchBaseline (items);
+
+    printf ("items:            %lld\n", (long long)items);
+    printf ("baseline:         %10.2f ms\n", baseline / 1000000.0);
+    printf ("threads        ms   speed-up   efficiency\n");
+
+    double single = 0.0;
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        double elapsed = benchParallel (items, threads);
+        double speedup = baseline / elapsed;
+        if (threads == 1) single = elapsed;
+        printf ("%7d %9.2f %10.3f %12.3f\n",
+                threads, elapsed / 1000000.0, speedup, speedup / threads);
+        if (threads == max_threads) break;
+    }
+
+    return (single <= baseline * 1.1) ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file progress-replay.cc
+ * @brief Replays a trace recorded by ProgressRecorder and prints the cost
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ *
+ * Usage: progress-replay <trace-file> [repetitions]
+ *
+ * The file holds the bytes of ProgressRecorder::data (). The trace is
+ * replayed on a fresh Progress instance (see ProgressReplay::run())
+ * and the measurements are printed, one per line. The global operator
+ * new is replaced so that the allocations made during the replay are
+ * counted as well.
+ */
+
+#include "progress-trace.h"
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QFile>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+//! Number of calls to operator new in the process.
+static QAtomicInteger<qint64> allocations;
+
+void * operator new (size_t size)
+{
+    allocations.fetchAndAddRelaxed (1);
+    void * result = malloc (size == 0 ? 1 : size);
+    if (result == NULL) throw std::bad_alloc ();
+    return result;
+}
+
+void operator delete (void * ptr) noexcept
+{
+    free (ptr);
+}
+
+//! The counter given to ProgressReplay.
+static int64_t countAllocations ()
+{
+    return allocations.load ();
+}
+
+int main (int argc, char * argv[])
+{
+    if (argc < 2) {
+        fprintf (stderr, "usage: %s <trace-file> [repetitions]\n", argv[0]);
+        return 2;
+    }
+    int repetitions = argc > 2 ? atoi (argv[2]) : 1;
+    if (repetitions <= 0) repetitions = 1;
+
+    QFile file (QString::fromLocal8Bit (argv[1]));
+    if (!file.open (QIODevice::ReadOnly)) {
+        fprintf (stderr, "unable to open %s\n", argv[1]);
+        return 1;
+    }
+    QByteArray trace = file.readAll ();
+    file.close ();
+
+    ProgressReplay replay;
+    if (!replay.load (trace)) {
+        fprintf (stderr, "%s is not a valid progress trace\n", argv[1]);
+        return 1;
+    }
+    replay.setAllocationCounter (countAllocations);
+
+    ProgressReplay::Result r = replay.run (repetitions);
+    printf ("calls:              %lld\n", (long long)r.calls_);
+    printf ("repetitions:        %d\n", repetitions);
+    printf ("elapsed:            %lld ns\n", (long long)r.elapsed_ns_);
+    printf ("per call:           %.2f ns\n", r.ns_per_call_);
+    printf ("signals emitted:    %lld\n", (long long)r.signals_emitted_);
+    printf ("signals suppressed: %lld\n", (long long)r.signals_suppressed_);
+    printf ("allocations:        %lld\n", (long long)r.allocations_);
+    if (r.calls_ > 0) {
+        printf ("allocations/call:   %.3f\n",
+                (double)r.allocations_ / r.calls_);
+    }
+    return 0;
+}
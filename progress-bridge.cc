@@ -0,0 +1,219 @@
+/**
+ * @file progress-bridge.cc
+ * @brief Definitions for ProgressBridge class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-bridge.h"
+#include "progress.h"
+#include "progress-private.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QMutexLocker>
+
+/**
+ * @class ProgressBridge
+ *
+ * A worker thread that forwards each Progress callback as a queued
+ * signal may put thousands of events per second in the queue of the
+ * receiving thread, and the receiver falls behind. The bridge instead
+ * keeps only the latest values: the subscriber that attach () adds
+ * stores them and posts an event to the bridge only if none is pending.
+ * When the event is processed in the thread of the bridge, the latest
+ * values are taken and progressChanged () (and statusChanged (), if the
+ * label changed) are emitted there. Thus the receiving thread has at
+ * most one event from the bridge in its queue and never sees stale
+ * values.
+ *
+ * cancel () may be called from the receiving thread. Progress is not
+ * thread-safe, so the request is kept in an atomic flag and the
+ * subscriber returns false on its next invocation, which sets the
+ * stop flag of the instance in the worker thread (the same flag that
+ * setStop () sets).
+ *
+ * attach () and detach () must be called while the instance is not
+ * used by the worker. The bridge must outlive the attachment.
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressBridge::ProgressBridge (QObject * parent) :
+    QObject (parent),
+    progress_(NULL),
+    subscriber_id_(0),
+    mutex_(),
+    pending_total_(0),
+    pending_progress_(0),
+    pending_status_(),
+    pending_since_ns_(0),
+    b_event_pending_(false),
+    b_cancel_(0),
+    updates_received_(0),
+    events_posted_(0),
+    last_latency_ns_(0),
+    delivered_status_(),
+    clock_()
+{
+    PROGRESS_TRACE_ENTRY;
+    clock_.start ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressBridge::~ProgressBridge ()
+{
+    PROGRESS_TRACE_ENTRY;
+    detach ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param progress The instance to forward.
+ * @param granularity Minimum advance of the total progress.
+ * @param interval_ms Minimum time between two updates; 0 for none.
+ */
+void ProgressBridge::attach (
+        Progress * progress, int64_t granularity, int interval_ms)
+{
+    PROGRESS_TRACE_ENTRY;
+    detach ();
+    b_cancel_.fetchAndStoreOrdered (0);
+    progress_ = progress;
+    subscriber_id_ = progress_->addSubscriber (
+                progressSignal, this, INT_MAX, granularity, interval_ms);
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressBridge::detach ()
+{
+    PROGRESS_TRACE_ENTRY;
+    if (progress_ != NULL) {
+        progress_->removeSubscriber (subscriber_id_);
+        subscriber_id_ = 0;
+        progress_ = NULL;
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int64_t ProgressBridge::updatesReceived ()
+{
+    QMutexLocker lock (&mutex_);
+    return updates_received_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int64_t ProgressBridge::eventsPosted ()
+{
+    QMutexLocker lock (&mutex_);
+    return events_posted_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressBridge::cancel ()
+{
+    PROGRESS_TRACE_ENTRY;
+    b_cancel_.fetchAndStoreOrdered (1);
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param e The event to process.
+ * @return true if the event was handled
+ */
+bool ProgressBridge::event (QEvent * e)
+{
+    if (e->type () != eventType ()) {
+        return QObject::event (e);
+    }
+
+    int64_t total;
+    int64_t progress;
+    QString status;
+    {
+        QMutexLocker lock (&mutex_);
+        total = pending_total_;
+        progress = pending_progress_;
+        status = pending_status_;
+        last_latency_ns_ = clock_.nsecsElapsed () - pending_since_ns_;
+        b_event_pending_ = false;
+    }
+
+    if (status != delivered_status_) {
+        delivered_status_ = status;
+        emit statusChanged (status);
+    }
+    emit progressChanged (total, progress);
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Runs in the thread that drives the Progress instance.
+ */
+bool ProgressBridge::progressSignal (
+        int64_t total_size, int64_t progress, const QString & status,
+        void * level_data, void * global_data)
+{
+    Q_UNUSED(level_data);
+    ProgressBridge * bridge = static_cast<ProgressBridge *>(global_data);
+
+    bool b_post;
+    {
+        QMutexLocker lock (&bridge->mutex_);
+        bridge->pending_total_ = total_size;
+        bridge->pending_progress_ = progress;
+        bridge->pending_status_ = status;
+        ++bridge->updates_received_;
+
+        b_post = !bridge->b_event_pending_;
+        if (b_post) {
+            bridge->b_event_pending_ = true;
+            bridge->pending_since_ns_ = bridge->clock_.nsecsElapsed ();
+            ++bridge->events_posted_;
+        }
+    }
+
+    // the queue takes ownership of the event
+    if (b_post) {
+        QCoreApplication::postEvent (
+                    bridge, new QEvent ((QEvent::Type)eventType ()));
+    }
+
+    return !bridge->isCanceled ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProgressBridge::eventType ()
+{
+    static int type = QEvent::registerEventType ();
+    return type;
+}
+/* ========================================================================= */
@@ -0,0 +1,158 @@
+/**
+ * @file progress-bridge.h
+ * @brief Declarations for ProgressBridge class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_BRIDGE_H_INCLUDE
+#define GUARD_PROGRESS_BRIDGE_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <stdint.h>
+
+class Progress;
+QT_BEGIN_NAMESPACE
+class QEvent;
+QT_END_NAMESPACE
+
+//! Delivers the progress of a worker thread to the thread of this object.
+class PROGRESS_EXPORT ProgressBridge : public QObject {
+    Q_OBJECT
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    Progress * progress_; /**< attached instance (may be NULL) */
+    int subscriber_id_; /**< our subscriber in progress_ */
+
+    QMutex mutex_; /**< guards the pending values */
+    int64_t pending_total_; /**< latest total */
+    int64_t pending_progress_; /**< latest progress */
+    QString pending_status_; /**< latest status */
+    int64_t pending_since_ns_; /**< when the pending event was posted */
+    bool b_event_pending_; /**< an event is in the queue of our thread */
+
+    QAtomicInt b_cancel_; /**< the receiving side asked for a stop */
+
+    int64_t updates_received_; /**< changes from the worker (guarded) */
+    int64_t events_posted_; /**< events put in the queue (guarded) */
+    int64_t last_latency_ns_; /**< queue time of the last event */
+    QString delivered_status_; /**< status at last delivery */
+    QElapsedTimer clock_; /**< time base for latency */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; the bridge delivers in the thread of @a parent.
+    explicit ProgressBridge (
+            QObject * parent = NULL);
+
+    //! Destructor; detaches.
+    virtual
+    ~ProgressBridge ();
+
+
+    //! Forward the changes of this instance (adds a subscriber).
+    void
+    attach (
+            Progress * progress,
+            int64_t granularity = 1,
+            int interval_ms = 0);
+
+    //! Stop forwarding the changes of attached instance.
+    void
+    detach ();
+
+
+    //! Tell if cancel() was called since last attach ().
+    inline bool
+    isCanceled () const {
+        return b_cancel_.load () != 0;
+    }
+
+    //! Number of changes received from the worker.
+    int64_t
+    updatesReceived ();
+
+    //! Number of events that were posted (at most one at a time).
+    int64_t
+    eventsPosted ();
+
+    //! Time the last delivered event spent in the queue (nanoseconds).
+    inline int64_t
+    lastLatency () const {
+        return last_latency_ns_;
+    }
+
+
+public slots:
+
+    //! Ask the worker to stop (the attached Progress will see setStop()).
+    void
+    cancel ();
+
+
+signals:
+
+    //! The progress changed; only the latest values are delivered.
+    void
+    progressChanged (
+            qint64 total,
+            qint64 progress);
+
+    //! The label for current operation changed.
+    void
+    statusChanged (
+            const QString & status);
+
+
+protected:
+
+    //! Receives the coalesced updates.
+    virtual bool
+    event (
+            QEvent * e);
+
+private:
+
+    //! The subscriber added by attach (); runs in the worker thread.
+    static bool
+    progressSignal (
+            int64_t total_size,
+            int64_t progress,
+            const QString & status,
+            void * level_data,
+            void * global_data);
+
+    //! The type of the events we post.
+    static int
+    eventType ();
+
+}; // class ProgressBridge
+
+#endif // GUARD_PROGRESS_BRIDGE_H_INCLUDE
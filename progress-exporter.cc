@@ -0,0 +1,409 @@
+/**
+ * @file progress-exporter.cc
+ * @brief Definitions for ProgressExporter class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-exporter.h"
+#include "progress.h"
+#include "progress-private.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+/**
+ * @class ProgressExporter
+ *
+ * The exporter keeps a list of Progress instances, each with a
+ * ProgressSnapshot that the instance updates every time it computes
+ * the progress (see Progress::setSnapshot()). A scrape reads the
+ * snapshots and formats them in OpenMetrics text format, so it never
+ * touches the Progress itself.
+ *
+ * The exporter is a QObject and serves the clients from the thread it
+ * lives in; that thread needs an event loop. On a local socket the
+ * exposition is written as soon as a client connects; on the TCP port
+ * (bound to localhost only) a minimal HTTP response is sent after the
+ * request was received.
+ *
+ * The exporter and the instances share the snapshots (see
+ * ProgressSnapshot::release()), so either side may go away first: the
+ * exporter never touches an instance after addProgress () and an
+ * instance that was destroyed is no longer part of the exposition.
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressExporter::ProgressExporter (QObject * parent) :
+    QObject (parent),
+    mutex_(),
+    entries_(),
+    local_server_(NULL),
+    tcp_server_(NULL)
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressExporter::~ProgressExporter ()
+{
+    PROGRESS_TRACE_ENTRY;
+    close ();
+
+    QMutexLocker lock (&mutex_);
+    foreach (const Entry & e, entries_) {
+        ProgressSnapshot::release (e.snapshot_);
+    }
+    entries_.clear ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param name Path of the Unix domain socket or name of the pipe;
+ *             a stale socket with the same name is removed.
+ * @return true if the server is listening
+ */
+bool ProgressExporter::listenLocal (const QString & name)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (local_server_ == NULL) {
+        local_server_ = new QLocalServer (this);
+        connect (local_server_, SIGNAL(newConnection()),
+                 this, SLOT(newLocalConnection()));
+    } else {
+        local_server_->close ();
+    }
+
+    QLocalServer::removeServer (name);
+    bool b_ret = local_server_->listen (name);
+    if (!b_ret) {
+        PROGRESS_DEBUGM ("  unable to listen on local socket\n");
+    }
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param port The port to use; 0 lets the system choose one
+ *             (see tcpPort()).
+ * @return true if the server is listening
+ */
+bool ProgressExporter::listenTcp (quint16 port)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (tcp_server_ == NULL) {
+        tcp_server_ = new QTcpServer (this);
+        connect (tcp_server_, SIGNAL(newConnection()),
+                 this, SLOT(newTcpConnection()));
+    } else {
+        tcp_server_->close ();
+    }
+
+    bool b_ret = tcp_server_->listen (QHostAddress::LocalHost, port);
+    if (!b_ret) {
+        PROGRESS_DEBUGM ("  unable to listen on port %d\n", (int)port);
+    }
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+quint16 ProgressExporter::tcpPort () const
+{
+    if (tcp_server_ == NULL) return 0;
+    return tcp_server_->serverPort ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressExporter::close ()
+{
+    PROGRESS_TRACE_ENTRY;
+    if (local_server_ != NULL) {
+        local_server_->close ();
+    }
+    if (tcp_server_ != NULL) {
+        tcp_server_->close ();
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The instance should not be running (no other thread should be using
+ * it) while it is being added.
+ *
+ * @param progress The instance to export.
+ * @param name The value of the `name` label in the exposition.
+ * @return false if the instance was already registered
+ */
+bool ProgressExporter::addProgress (Progress * progress, const QString & name)
+{
+    PROGRESS_TRACE_ENTRY;
+    QMutexLocker lock (&mutex_);
+    pruneEntries ();
+    foreach (const Entry & e, entries_) {
+        if (e.progress_ == progress) {
+            PROGRESS_TRACE_EXIT;
+            return false;
+        }
+    }
+
+    Entry e;
+    e.progress_ = progress;
+    e.name_ = name;
+    e.snapshot_ = new ProgressSnapshot ();
+    entries_.append (e);
+    progress->setSnapshot (e.snapshot_);
+
+    PROGRESS_TRACE_EXIT;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The instance is not accessed, so it may have been destroyed already.
+ * If it is still alive it keeps publishing into its snapshot, which
+ * nobody reads, until it is destroyed or Progress::setSnapshot() is
+ * called.
+ *
+ * @param progress The instance to remove.
+ */
+void ProgressExporter::removeProgress (Progress * progress)
+{
+    PROGRESS_TRACE_ENTRY;
+    QMutexLocker lock (&mutex_);
+    for (int i = 0; i < entries_.size (); ++i) {
+        const Entry & e = entries_.at (i);
+        if (e.progress_ == progress) {
+            ProgressSnapshot::release (e.snapshot_);
+            entries_.removeAt (i);
+            break;
+        }
+    }
+    pruneEntries ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressExporter::pruneEntries ()
+{
+    for (int i = entries_.size () - 1; i >= 0; --i) {
+        const Entry & e = entries_.at (i);
+        if (!e.snapshot_->hasWriter ()) {
+            ProgressSnapshot::release (e.snapshot_);
+            entries_.removeAt (i);
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+//! Escape a label value as required by the OpenMetrics text format.
+static QByteArray escapeLabel (const QByteArray & value)
+{
+    QByteArray result;
+    result.reserve (value.size ());
+    for (int i = 0; i < value.size (); ++i) {
+        char c = value.at (i);
+        if (c == '\\') {
+            result.append ("\\\\");
+        } else if (c == '"') {
+            result.append ("\\\"");
+        } else if (c == '\n') {
+            result.append ("\\n");
+        } else {
+            result.append (c);
+        }
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+//! Append the metric family header.
+static void appendFamily (
+        QByteArray & out, const char * name,
+        const char * type, const char * help)
+{
+    out.append ("# TYPE ").append (name).append (' ').append (type).append ('\n');
+    out.append ("# HELP ").append (name).append (' ').append (help).append ('\n');
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+//! Append a single sample with the `name` label.
+static void appendSample (
+        QByteArray & out, const char * metric,
+        const QByteArray & name, qint64 value)
+{
+    out.append (metric).append ("{name=\"").append (name).append ("\"} ");
+    out.append (QByteArray::number (value)).append ('\n');
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QByteArray ProgressExporter::scrape () const
+{
+    PROGRESS_TRACE_ENTRY;
+
+    QList<QByteArray> names;
+    QList<ProgressSnapshot::Values> values;
+    {
+        QMutexLocker lock (&mutex_);
+        foreach (const Entry & e, entries_) {
+            // the instance was destroyed or detached
+            if (!e.snapshot_->hasWriter ()) continue;
+            ProgressSnapshot::Values v;
+            e.snapshot_->read (v);
+            names.append (escapeLabel (e.name_.toUtf8 ()));
+            values.append (v);
+        }
+    }
+
+    QByteArray out;
+    int i_max = names.size ();
+
+    appendFamily (out, "progress_value", "gauge",
+                  "Resolved progress in units of the total.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_value", names.at (i), values.at (i).progress_);
+    }
+
+    appendFamily (out, "progress_total", "gauge",
+                  "Total reported together with the progress.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_total", names.at (i), values.at (i).total_);
+    }
+
+    appendFamily (out, "progress_depth", "gauge",
+                  "Number of nested portions.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_depth", names.at (i), values.at (i).depth_);
+    }
+
+    appendFamily (out, "progress_signals_emitted", "counter",
+                  "Callbacks invoked.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_signals_emitted_total",
+                      names.at (i), values.at (i).emitted_);
+    }
+
+    appendFamily (out, "progress_signals_suppressed", "counter",
+                  "Changes dropped by cutoff level or granularity.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_signals_suppressed_total",
+                      names.at (i), values.at (i).suppressed_);
+    }
+
+    appendFamily (out, "progress_should_stop", "gauge",
+                  "1 if the operation was asked to stop.");
+    for (int i = 0; i < i_max; ++i) {
+        appendSample (out, "progress_should_stop",
+                      names.at (i), values.at (i).b_should_stop_ ? 1 : 0);
+    }
+
+    appendFamily (out, "progress_status", "info",
+                  "Label of the current operation.");
+    for (int i = 0; i < i_max; ++i) {
+        out.append ("progress_status_info{name=\"").append (names.at (i));
+        out.append ("\",status=\"");
+        out.append (escapeLabel (QByteArray (values.at (i).label_)));
+        out.append ("\"} 1\n");
+    }
+
+    out.append ("# EOF\n");
+
+    PROGRESS_TRACE_EXIT;
+    return out;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressExporter::newLocalConnection ()
+{
+    PROGRESS_TRACE_ENTRY;
+    while (local_server_->hasPendingConnections ()) {
+        QLocalSocket * client = local_server_->nextPendingConnection ();
+        connect (client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+        client->write (scrape ());
+        client->disconnectFromServer ();
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressExporter::newTcpConnection ()
+{
+    PROGRESS_TRACE_ENTRY;
+    while (tcp_server_->hasPendingConnections ()) {
+        QTcpSocket * client = tcp_server_->nextPendingConnection ();
+        connect (client, SIGNAL(disconnected()), client, SLOT(deleteLater()));
+        connect (client, SIGNAL(readyRead()), this, SLOT(tcpReadyRead()));
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressExporter::tcpReadyRead ()
+{
+    PROGRESS_TRACE_ENTRY;
+    for (;;) {
+        QTcpSocket * client = qobject_cast<QTcpSocket *>(sender ());
+        if (client == NULL) break;
+
+        // wait for the end of the request headers; the body is ignored
+        QByteArray request = client->peek (client->bytesAvailable ());
+        if (!request.contains ("\r\n\r\n") && !request.contains ("\n\n")) {
+            if (request.size () < 8192) break;
+        }
+        client->readAll ();
+        disconnect (client, SIGNAL(readyRead()), this, SLOT(tcpReadyRead()));
+
+        QByteArray body = scrape ();
+        QByteArray response (
+                    "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: application/openmetrics-text; "
+                    "version=1.0.0; charset=utf-8\r\n"
+                    "Content-Length: ");
+        response.append (QByteArray::number (body.size ()));
+        response.append ("\r\nConnection: close\r\n\r\n");
+        response.append (body);
+
+        client->write (response);
+        client->disconnectFromHost ();
+        break;
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
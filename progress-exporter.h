@@ -0,0 +1,134 @@
+/**
+ * @file progress-exporter.h
+ * @brief Declarations for ProgressExporter class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_EXPORTER_H_INCLUDE
+#define GUARD_PROGRESS_EXPORTER_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include "progress-snapshot.h"
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <stdint.h>
+
+class Progress;
+QT_BEGIN_NAMESPACE
+class QLocalServer;
+class QTcpServer;
+QT_END_NAMESPACE
+
+//! Serves the state of Progress instances in OpenMetrics text format.
+class PROGRESS_EXPORT ProgressExporter : public QObject {
+    Q_OBJECT
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+    //! A registered instance.
+    struct Entry {
+        Progress * progress_; /**< only used as a key; never dereferenced */
+        QString name_;
+        ProgressSnapshot * snapshot_; /**< we hold a reference */
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    mutable QMutex mutex_; /**< guards entries_; never used by Progress */
+    QList<Entry> entries_; /**< registered instances */
+
+    QLocalServer * local_server_;
+    QTcpServer * tcp_server_;
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; the exporter does not listen until asked to.
+    explicit ProgressExporter (
+            QObject * parent = NULL);
+
+    //! Destructor; releases the snapshots and closes the servers.
+    virtual
+    ~ProgressExporter ();
+
+
+    //! Serve the metrics on a local socket (Unix domain socket or pipe).
+    bool
+    listenLocal (
+            const QString & name);
+
+    //! Serve the metrics over HTTP on a localhost port.
+    bool
+    listenTcp (
+            quint16 port);
+
+    //! Port used by the TCP server (useful when listenTcp() got 0).
+    quint16
+    tcpPort () const;
+
+    //! Stop serving.
+    void
+    close ();
+
+
+    //! Start exporting the state of an instance.
+    bool
+    addProgress (
+            Progress * progress,
+            const QString & name);
+
+    //! Stop exporting the state of an instance (which may be destroyed).
+    void
+    removeProgress (
+            Progress * progress);
+
+    //! Compose the exposition for all registered instances.
+    QByteArray
+    scrape () const;
+
+
+private:
+
+    //! Drop the entries of instances that were destroyed; mutex_ is held.
+    void
+    pruneEntries ();
+
+private slots:
+
+    //! A client connected to the local socket.
+    void
+    newLocalConnection ();
+
+    //! A client connected to the TCP port.
+    void
+    newTcpConnection ();
+
+    //! A TCP client sent (part of) its request.
+    void
+    tcpReadyRead ();
+
+}; // class ProgressExporter
+
+#endif // GUARD_PROGRESS_EXPORTER_H_INCLUDE
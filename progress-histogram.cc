@@ -0,0 +1,299 @@
+/**
+ * @file progress-histogram.cc
+ * @brief Definitions for ProgressHistogram class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-histogram.h"
+#include "progress-private.h"
+#include <QMutexLocker>
+#include <string.h>
+
+/**
+ * @class ProgressHistogram
+ *
+ * When attached to one or more Progress instances (see
+ * Progress::setHistogram()) the aggregator receives the wall time of
+ * each labelled portion when it is finished. Portions without a label
+ * of their own are not recorded.
+ *
+ * Labels are interned: each distinct label gets an integer id once and
+ * the portions keep that id, so recording does not hash strings.
+ *
+ * Each thread records into its own shard; the mutex of a shard is only
+ * contended while statistics() or reset() merges the shards.
+ *
+ * Durations are kept in log-linear buckets: values below SUB_BUCKETS
+ * are exact, larger values share a bucket with values that differ by
+ * at most 1/SUB_BUCKETS. Reported percentiles are the highest value
+ * of the bucket (capped at the maximum seen).
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressHistogram::ProgressHistogram () :
+    mutex_(),
+    labels_(),
+    label_names_(),
+    shards_(),
+    local_()
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Threads that recorded into this instance must not use it anymore.
+ */
+ProgressHistogram::~ProgressHistogram ()
+{
+    PROGRESS_TRACE_ENTRY;
+    foreach (Shard * s, shards_) {
+        qDeleteAll (s->histograms_);
+        delete s;
+    }
+    shards_.clear ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The lookup is first performed in the cache of the calling thread,
+ * so the global lock is only taken the first time a thread sees a label.
+ *
+ * @param label The label to intern.
+ * @return the id or -1 if the label is empty
+ */
+int ProgressHistogram::intern (const QString & label)
+{
+    if (label.isEmpty ()) return -1;
+
+    Shard * s = localShard ();
+    QHash<QString, int>::const_iterator it = s->labels_.constFind (label);
+    if (it != s->labels_.constEnd ()) {
+        return it.value ();
+    }
+
+    int id;
+    {
+        QMutexLocker lock (&mutex_);
+        id = labels_.value (label, -1);
+        if (id == -1) {
+            id = label_names_.size ();
+            label_names_.append (label);
+            labels_.insert (label, id);
+        }
+    }
+    s->labels_.insert (label, id);
+    return id;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param label_id The id returned by intern().
+ * @param elapsed_ns The duration in nanoseconds.
+ */
+void ProgressHistogram::record (int label_id, int64_t elapsed_ns)
+{
+    if (label_id < 0) return;
+    if (elapsed_ns < 0) elapsed_ns = 0;
+
+    Shard * s = localShard ();
+    QMutexLocker lock (&s->mutex_);
+
+    if (s->histograms_.size () <= label_id) {
+        s->histograms_.resize (label_id + 1);
+    }
+    Histogram * h = s->histograms_.at (label_id);
+    if (h == NULL) {
+        h = new Histogram;
+        memset (h, 0, sizeof(Histogram));
+        s->histograms_[label_id] = h;
+    }
+
+    ++h->count_;
+    h->total_ns_ += elapsed_ns;
+    if (elapsed_ns > h->max_ns_) {
+        h->max_ns_ = elapsed_ns;
+    }
+    ++h->buckets_[bucketIndex (elapsed_ns)];
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QList<ProgressHistogram::Stats> ProgressHistogram::statistics () const
+{
+    PROGRESS_TRACE_ENTRY;
+    QMutexLocker lock (&mutex_);
+
+    // merge the shards into one histogram per label
+    int label_count = label_names_.size ();
+    QVector<Histogram> merged (label_count);
+    if (label_count > 0) {
+        memset (merged.data (), 0, sizeof(Histogram) * label_count);
+    }
+    foreach (Shard * s, shards_) {
+        QMutexLocker shard_lock (&s->mutex_);
+        int i_max = qMin (s->histograms_.size (), label_count);
+        for (int i = 0; i < i_max; ++i) {
+            const Histogram * src = s->histograms_.at (i);
+            if (src == NULL) continue;
+            Histogram & dst = merged[i];
+            dst.count_ += src->count_;
+            dst.total_ns_ += src->total_ns_;
+            dst.max_ns_ = qMax (dst.max_ns_, src->max_ns_);
+            for (int b = 0; b < BUCKETS; ++b) {
+                dst.buckets_[b] += src->buckets_[b];
+            }
+        }
+    }
+
+    QList<Stats> result;
+    for (int i = 0; i < label_count; ++i) {
+        const Histogram & h = merged.at (i);
+        if (h.count_ == 0) continue;
+
+        Stats st;
+        st.label_ = label_names_.at (i);
+        st.count_ = h.count_;
+        st.total_ns_ = h.total_ns_;
+        st.max_ns_ = h.max_ns_;
+        st.p50_ns_ = -1;
+        st.p99_ns_ = -1;
+
+        // ranks are 1-based and rounded up
+        int64_t rank_50 = (h.count_ * 50 + 99) / 100;
+        int64_t rank_99 = (h.count_ * 99 + 99) / 100;
+        int64_t seen = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            seen += h.buckets_[b];
+            if ((st.p50_ns_ < 0) && (seen >= rank_50)) {
+                st.p50_ns_ = qMin (bucketHighest (b), h.max_ns_);
+            }
+            if (seen >= rank_99) {
+                st.p99_ns_ = qMin (bucketHighest (b), h.max_ns_);
+                break;
+            }
+        }
+        result.append (st);
+    }
+
+    PROGRESS_TRACE_EXIT;
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * One line for each label, with times in microseconds:
+ * `label count=N p50=X p99=Y max=Z`.
+ */
+QString ProgressHistogram::report () const
+{
+    QString result;
+    foreach (const Stats & st, statistics ()) {
+        result.append (
+                    QString ("%1 count=%2 p50=%3us p99=%4us max=%5us\n")
+                    .arg (st.label_)
+                    .arg (st.count_)
+                    .arg (st.p50_ns_ / 1000)
+                    .arg (st.p99_ns_ / 1000)
+                    .arg (st.max_ns_ / 1000));
+    }
+    return result;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressHistogram::reset ()
+{
+    PROGRESS_TRACE_ENTRY;
+    QMutexLocker lock (&mutex_);
+    foreach (Shard * s, shards_) {
+        QMutexLocker shard_lock (&s->mutex_);
+        foreach (Histogram * h, s->histograms_) {
+            if (h != NULL) {
+                memset (h, 0, sizeof(Histogram));
+            }
+        }
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param value A non-negative value.
+ * @return the index in [0, BUCKETS)
+ */
+int ProgressHistogram::bucketIndex (int64_t value)
+{
+    uint64_t v = value < 0 ? 0 : (uint64_t)value;
+    if (v < SUB_BUCKETS) return (int)v;
+
+    // position of the most significant bit
+    int msb = 0;
+    for (int step = 32; step > 0; step /= 2) {
+        if ((v >> (msb + step)) != 0) {
+            msb += step;
+        }
+    }
+
+    // SUB_BUCKETS is 2^4
+    int shift = msb - 4;
+    int sub = (int)((v >> shift) & (SUB_BUCKETS - 1));
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param index The index of the bucket.
+ * @return the largest value v for which bucketIndex (v) == index
+ */
+int64_t ProgressHistogram::bucketHighest (int index)
+{
+    if (index < SUB_BUCKETS) return index;
+    int shift = index / SUB_BUCKETS - 1;
+    int sub = index % SUB_BUCKETS;
+    uint64_t lowest = (uint64_t)(SUB_BUCKETS + sub) << shift;
+    uint64_t highest = lowest + ((uint64_t)1 << shift) - 1;
+    if (highest > (uint64_t)INT64_MAX) return INT64_MAX;
+    return (int64_t)highest;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressHistogram::Shard * ProgressHistogram::localShard ()
+{
+    ShardRef * ref = local_.localData ();
+    if (ref == NULL) {
+        ref = new ShardRef;
+        ref->shard_ = new Shard;
+        local_.setLocalData (ref);
+
+        QMutexLocker lock (&mutex_);
+        shards_.append (ref->shard_);
+    }
+    return ref->shard_;
+}
+/* ========================================================================= */
@@ -0,0 +1,148 @@
+/**
+ * @file progress-histogram.h
+ * @brief Declarations for ProgressHistogram class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_HISTOGRAM_H_INCLUDE
+#define GUARD_PROGRESS_HISTOGRAM_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadStorage>
+#include <QVector>
+#include <stdint.h>
+
+//! Aggregates the duration of labelled portions across runs.
+class PROGRESS_EXPORT ProgressHistogram {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+public:
+
+    //! Number of linear sub-buckets in each power of two.
+    enum { SUB_BUCKETS = 16 };
+
+    //! Total number of buckets in a histogram.
+    enum { BUCKETS = 64 * SUB_BUCKETS };
+
+    //! Statistics for one label.
+    struct Stats {
+        QString label_;
+        int64_t count_;
+        int64_t total_ns_;
+        int64_t p50_ns_;
+        int64_t p99_ns_;
+        int64_t max_ns_;
+    };
+
+private:
+
+    //! Durations recorded for a label.
+    struct Histogram {
+        int64_t count_;
+        int64_t total_ns_;
+        int64_t max_ns_;
+        int64_t buckets_[BUCKETS];
+    };
+
+    //! Data owned by a thread.
+    struct Shard {
+        QMutex mutex_; /**< taken by the owner and by merge () */
+        QVector<Histogram *> histograms_; /**< indexed by label id */
+        QHash<QString, int> labels_; /**< local cache of interned labels */
+    };
+
+    //! Per-thread pointer to a shard owned by the aggregator.
+    struct ShardRef {
+        Shard * shard_;
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    mutable QMutex mutex_; /**< guards labels_, label_names_ and shards_ */
+    QHash<QString, int> labels_; /**< label to id */
+    QStringList label_names_; /**< id to label */
+    QList<Shard *> shards_; /**< all shards ever created */
+
+    QThreadStorage<ShardRef *> local_; /**< shard of current thread */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; creates an empty aggregator.
+    ProgressHistogram ();
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressHistogram ();
+
+
+    //! Get the id of a label; -1 for empty labels.
+    int
+    intern (
+            const QString & label);
+
+    //! Record the duration of a portion with given label id.
+    void
+    record (
+            int label_id,
+            int64_t elapsed_ns);
+
+    //! Merge all shards and compute the statistics for each label.
+    QList<Stats>
+    statistics () const;
+
+    //! Merge all shards and compose a human readable report.
+    QString
+    report () const;
+
+    //! Forget all recorded durations (labels are kept).
+    void
+    reset ();
+
+
+    //! Index of the bucket for a value.
+    static int
+    bucketIndex (
+            int64_t value);
+
+    //! Highest value that maps to given bucket.
+    static int64_t
+    bucketHighest (
+            int index);
+
+private:
+
+    //! The shard of the calling thread (created on first use).
+    Shard *
+    localShard ();
+
+    Q_DISABLE_COPY(ProgressHistogram)
+
+}; // class ProgressHistogram
+
+#endif // GUARD_PROGRESS_HISTOGRAM_H_INCLUDE
@@ -0,0 +1,523 @@
+/**
+ * @file progress-multi.h
+ * @brief Declarations for ProgressMulti class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_MULTI_H_INCLUDE
+#define GUARD_PROGRESS_MULTI_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QList>
+#include <QString>
+#include <limits.h>
+#include <stdint.h>
+
+/**
+ * @class ProgressMulti
+ *
+ * Same model as Progress (a stack of nested portions, each mapped
+ * into its parent by an offset and a size) but every portion tracks
+ * K metrics at once (bytes, items, records...). Each metric has its own
+ * offset, size in parent and total, so a sub-task may take 10% of the
+ * bytes but 50% of the records of its parent.
+ *
+ * The portion stores each field as an array of K lanes, so a single
+ * traversal of the stack updates all metrics. The stack walk, the
+ * granularity test and the callback are paid once for the K metrics
+ * instead of once per metric; the scaling itself is still one 64-bit
+ * division per lane and level. benchmarks/progress-multi-bench.cc
+ * compares a step of this class with a step of K Progress instances.
+ *
+ * A signal is emitted when at least one metric advanced by at least
+ * its granularity. The callback receives all K values.
+ */
+template <int K>
+class ProgressMulti {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+    //! Represents a level in our list of levels.
+    struct Portion {
+        // cppcheck-suppress unusedStructMember
+        int64_t offset_in_parent_[K];
+        // cppcheck-suppress unusedStructMember
+        int64_t size_in_parent_[K];
+
+        // cppcheck-suppress unusedStructMember
+        int64_t tot_size_[K];
+        // cppcheck-suppress unusedStructMember
+        int64_t progress_[K];
+
+        // cppcheck-suppress unusedStructMember
+        void * user_data_;
+
+        QString current_status_;
+    };
+
+public:
+
+    //! Number of metrics tracked by each portion.
+    enum { METRICS = K };
+
+    //! Callback used for signaling progress; arrays have K elements,
+    //! return false to request a stop.
+    typedef bool (*KbSignal) (
+            const int64_t * total_size,
+            const int64_t * progress,
+            const QString & status,
+            void * level_data,
+            void * global_data);
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    QList<Portion> stack_; /**< the list of nested portions */
+
+    int cutoff_level_; /**< only emit signals if the size of the
+                       stack is smaller than this value */
+    int64_t granularity_[K]; /**< advance by at least this much to generate signals */
+
+    int64_t prev_prog_[K]; /**< values last computed by signalChange () */
+
+    bool b_should_stop_;
+    QString current_status_;
+    void * user_data_;
+
+    KbSignal kb_full_signal_;
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+
+public:
+
+    //! Constructor; creates an empty progress object.
+    explicit ProgressMulti ();
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressMulti ();
+
+
+    //! Prepares the progress for a run.
+    bool
+    init (
+            const QString & title,
+            const int64_t * total_size);
+
+    //! Terminate a run (clear internal states).
+    void
+    end ();
+
+    //! Tell if the instance was initialized (init() was called).
+    inline bool
+    isInitialized () const {
+        return !stack_.isEmpty ();
+    }
+
+
+    //! Enters a new portion.
+    void
+    enter (
+            const int64_t * parent_size,
+            const QString &label,
+            const int64_t * total_size,
+            const int64_t * parent_offset = NULL,
+            void * portion_data = NULL);
+
+    //! Ends current portion; calls end() if this is the last one.
+    void
+    finish (
+            bool update_parent = true);
+
+
+    //! Tell the label for current operation.
+    inline const QString &
+    currentStatus () const {
+        return current_status_;
+    }
+
+
+    //! Size of the active portion of the stack.
+    inline int
+    cutoffLevel () const {
+        return cutoff_level_;
+    }
+
+    //! Size of the active portion of the stack.
+    inline void
+    setCutoffLevel (
+            int value) {
+        cutoff_level_ = value;
+    }
+
+
+    //! Emit signals when metric advances by at least this much.
+    inline int64_t
+    granularity (int metric) const {
+        return granularity_[metric];
+    }
+
+    //! Emit signals when metric advances by at least this much.
+    inline void
+    setGranularity (int metric, int64_t value) {
+        granularity_[metric] = value;
+    }
+
+
+    //! User data associated with the instance.
+    inline void *
+    userData () const {
+        return user_data_;
+    }
+
+    //! User data associated with the instance.
+    inline void
+    setUserData (void * value) {
+        user_data_ = value;
+    }
+
+
+    //! Callback to be used when progress changes.
+    inline KbSignal
+    callback () const {
+        return kb_full_signal_;
+    }
+
+    //! Callback to be used when progress changes.
+    inline void
+    setCallback (KbSignal value) {
+        kb_full_signal_ = value;
+    }
+
+
+    //! Perform a step in the context of top portion (all metrics).
+    bool
+    step (
+            const int64_t * chunk_size);
+
+    //! Perform a step in the context of top portion (single metric).
+    bool
+    step (
+            int metric,
+            int64_t chunk_size = 1);
+
+    //! Sets the internal state to signal the process should terminate.
+    inline void
+    setStop () {
+        b_should_stop_ = true;
+    }
+
+    //! Resets the internal state to signal the process should terminate.
+    inline void
+    resetStop () {
+        b_should_stop_ = false;
+    }
+
+    //! Tell if the process / operation should stop.
+    inline bool
+    shouldStop () const {
+        return b_should_stop_;
+    }
+
+
+private:
+
+    //! Starts from the bottom of the list and searches for a label.
+    QString
+    searchCurrentLabel ();
+
+    //! Signals a change in the progress.
+    void
+    signalChange ();
+
+
+}; // class ProgressMulti
+
+/*  FUNCTIONS    =========================================================== */
+//
+//
+//
+//
+/*  DEFINITIONS    --------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+template <int K>
+ProgressMulti<K>::ProgressMulti () :
+    stack_(),
+    cutoff_level_(INT_MAX),
+    b_should_stop_(false),
+    current_status_(),
+    user_data_(NULL),
+    kb_full_signal_(NULL)
+{
+    for (int k = 0; k < K; ++k) {
+        granularity_[k] = 1;
+        prev_prog_[k] = 0;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+template <int K>
+ProgressMulti<K>::~ProgressMulti ()
+{
+    end ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param title The name of this job.
+ * @param total_size Total size of this task for each of the K metrics;
+ *                   all must be positive.
+ * @return true if everything went fine
+ */
+template <int K>
+bool ProgressMulti<K>::init (const QString & title, const int64_t * total_size)
+{
+    end ();
+    for (int k = 0; k < K; ++k) {
+        if (total_size[k] <= 0) {
+            return false;
+        }
+    }
+
+    Portion p;
+    for (int k = 0; k < K; ++k) {
+        p.offset_in_parent_[k] = 0;
+        p.size_in_parent_[k] = total_size[k];
+        p.tot_size_[k] = total_size[k];
+        p.progress_[k] = 0;
+        prev_prog_[k] = 0;
+    }
+    p.user_data_ = NULL;
+    p.current_status_ = title;
+    stack_.push_front (p);
+
+    current_status_ = title;
+    b_should_stop_ = false;
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+template <int K>
+void ProgressMulti<K>::end ()
+{
+    stack_.clear ();
+    b_should_stop_ = true;
+    current_status_.clear ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * If the instance was not initialized the method will do that
+ * before proceeding.
+ *
+ * @param parent_size Size in parent for each metric.
+ * @param label The label for this portion; empty to inherit parent's.
+ * @param total_size Size of the portion for each metric.
+ * @param parent_offset Offset in parent for each metric; NULL to
+ *                      start at parent's current progress.
+ * @param portion_data User data for this level.
+ */
+template <int K>
+void ProgressMulti<K>::enter (
+        const int64_t * parent_size, const QString &label,
+        const int64_t * total_size, const int64_t * parent_offset,
+        void * portion_data)
+{
+    for (int k = 0; k < K; ++k) {
+        if (total_size[k] <= 0) {
+            return;
+        }
+    }
+
+    // special case when initialization is done via enter ()
+    if (!isInitialized ()) {
+        if (init (label, total_size)) {
+            stack_.first ().user_data_ = portion_data;
+        }
+        return;
+    }
+
+    // current first (parent of this one)
+    const Portion & f = stack_.first ();
+
+    Portion p;
+    for (int k = 0; k < K; ++k) {
+        p.offset_in_parent_[k] =
+                parent_offset == NULL ? f.progress_[k] : parent_offset[k];
+        p.size_in_parent_[k] = parent_size[k];
+        p.tot_size_[k] = total_size[k];
+        p.progress_[k] = 0;
+    }
+    p.user_data_ = portion_data;
+    p.current_status_ = label;
+    stack_.push_front (p);
+
+    if (!label.isEmpty ()) {
+        current_status_ = label;
+    }
+
+    signalChange ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param update_parent Move parent's progress at the end of this portion.
+ */
+template <int K>
+void ProgressMulti<K>::finish (bool update_parent)
+{
+    if (stack_.isEmpty ())
+        return;
+
+    // copy what we need from the portion to be dropped
+    const Portion f = stack_.first ();
+    stack_.pop_front ();
+
+    if (!f.current_status_.isEmpty ()) {
+        current_status_ = searchCurrentLabel ();
+    }
+
+    if (stack_.isEmpty ()) {
+        end ();
+    } else if (update_parent) {
+        Portion & newf = stack_.first ();
+        for (int k = 0; k < K; ++k) {
+            newf.progress_[k] = f.offset_in_parent_[k] + f.size_in_parent_[k];
+        }
+    }
+
+    signalChange ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param chunk_size Amount to advance for each of the K metrics;
+ *                   negative values are treated as 0.
+ * @return true if the process should continue, false to stop
+ */
+template <int K>
+bool ProgressMulti<K>::step (const int64_t * chunk_size)
+{
+    if (stack_.isEmpty ())
+        return false;
+
+    Portion & p = stack_.first ();
+    for (int k = 0; k < K; ++k) {
+        p.progress_[k] += chunk_size[k] > 0 ? chunk_size[k] : 0;
+    }
+
+    signalChange ();
+    return !b_should_stop_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param metric Index of the metric to advance.
+ * @param chunk_size Amount to advance.
+ * @return true if the process should continue, false to stop
+ */
+template <int K>
+bool ProgressMulti<K>::step (int metric, int64_t chunk_size)
+{
+    if (stack_.isEmpty () || (metric < 0) || (metric >= K) || (chunk_size < 0))
+        return false;
+
+    stack_.first ().progress_[metric] += chunk_size;
+
+    signalChange ();
+    return !b_should_stop_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+template <int K>
+QString ProgressMulti<K>::searchCurrentLabel ()
+{
+    foreach (const Portion & p, stack_) {
+        if (!p.current_status_.isEmpty ()) return p.current_status_;
+    }
+    return QString ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+template <int K>
+void ProgressMulti<K>::signalChange ()
+{
+    if (stack_.size () > cutoff_level_)
+        return;
+    if (stack_.isEmpty ())
+        return;
+
+    const Portion & f = stack_.first ();
+    int64_t in_parent[K];
+    int64_t total_progress[K];
+    for (int k = 0; k < K; ++k) {
+        in_parent[k] = f.progress_[k];
+    }
+
+    // one traversal of the stack scales all metrics together
+    foreach (const Portion & p, stack_) {
+        for (int k = 0; k < K; ++k) {
+            total_progress[k] = p.tot_size_[k];
+            in_parent[k] =
+                    p.offset_in_parent_[k] +
+                    (in_parent[k] * p.size_in_parent_[k]) /
+                    p.tot_size_[k];
+        }
+    }
+
+    // at least one metric must pass its granularity
+    bool b_advanced = false;
+    for (int k = 0; k < K; ++k) {
+        b_advanced |= (in_parent[k] - prev_prog_[k]) >= granularity_[k];
+    }
+    if (!b_advanced)
+        return;
+
+    for (int k = 0; k < K; ++k) {
+        prev_prog_[k] = in_parent[k];
+    }
+
+    if (kb_full_signal_ != NULL) {
+        if (!kb_full_signal_ (
+                    total_progress,
+                    in_parent,
+                    current_status_,
+                    f.user_data_,
+                    user_data_)) {
+            b_should_stop_ = true;
+        }
+    }
+}
+/* ========================================================================= */
+
+/*  DEFINITIONS    ========================================================= */
+
+#endif // GUARD_PROGRESS_MULTI_H_INCLUDE
@@ -0,0 +1,322 @@
+/**
+ * @file progress-parallel.cc
+ * @brief Definitions for ProgressParallel class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-parallel.h"
+#include "progress.h"
+#include "progress-private.h"
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+/**
+ * @class ProgressParallel
+ *
+ * The range is split in one contiguous block for each thread. A thread
+ * takes chunks from the front of its own block; when the block is
+ * exhausted it steals the back half of the remaining items of another
+ * thread. Each block has its own mutex, so threads only meet when
+ * stealing.
+ *
+ * The size of the chunks adapts to the cost of the items: after each
+ * chunk the size is scaled towards targetChunkTime () (at most doubled
+ * or halved at a time).
+ *
+ * Progress is not thread-safe, so only the calling thread (which is
+ * also one of the workers) touches it: after each of its chunks it
+ * collects the number of items done by all threads (atomic counters,
+ * so no lock is taken) and steps the top portion by the difference.
+ * When it runs out of items the caller keeps reporting and checking
+ * for stop requests every targetChunkTime () (between 1 and 100 ms)
+ * until the other threads are done. The caller should enter() a
+ * portion of size `end - begin` before calling run ().
+ *
+ * The loop stops (within one chunk on each thread) when the body returns
+ * false, when Progress::step () returns false (the instance was asked to
+ * stop by setStop (), by a callback or by a subscriber) or when shouldStop ()
+ * becomes true.
+ *
+ * Additional threads come from the global QThreadPool. If the pool is
+ * busy, the loop still completes on the calling thread; workers that
+ * were not started by then are cancelled.
+ */
+/*  DEFINITIONS    ========================================================= */
+
+namespace {
+
+//! A block of the range owned by a worker.
+struct Worker {
+    QMutex mutex_; /**< guards next_ and end_ */
+    int64_t next_; /**< first item not yet taken */
+    int64_t end_; /**< one past the last item */
+    QAtomicInteger<qint64> done_; /**< items processed by this worker */
+    QAtomicInt state_; /**< 0 - not started, 1 - started, 2 - cancelled */
+    char padding_[64]; /**< keep workers on separate cache lines */
+};
+
+//! State shared by the caller and the workers.
+struct Shared {
+    ProgressParallel::KbBody body_;
+    void * user_data_;
+    int64_t target_ns_;
+    QVector<Worker *> workers_;
+    QAtomicInt stop_;
+    QSemaphore finished_;
+
+    ~Shared () {
+        qDeleteAll (workers_);
+    }
+};
+
+//! Takes a chunk from worker's own block.
+bool takeChunk (Worker * w, int64_t chunk, int64_t & begin, int64_t & end)
+{
+    QMutexLocker lock (&w->mutex_);
+    if (w->next_ >= w->end_) return false;
+    begin = w->next_;
+    end = qMin (w->end_, begin + chunk);
+    w->next_ = end;
+    return true;
+}
+
+//! Moves the back half of another worker's block into own block.
+bool steal (Shared & sh, int index)
+{
+    int count = sh.workers_.size ();
+    for (int i = 1; i < count; ++i) {
+        Worker * victim = sh.workers_.at ((index + i) % count);
+        int64_t begin;
+        int64_t end;
+        {
+            QMutexLocker lock (&victim->mutex_);
+            int64_t remaining = victim->end_ - victim->next_;
+            if (remaining <= 0) continue;
+            begin = victim->end_ - (remaining + 1) / 2;
+            end = victim->end_;
+            victim->end_ = begin;
+        }
+
+        Worker * self = sh.workers_.at (index);
+        QMutexLocker lock (&self->mutex_);
+        self->next_ = begin;
+        self->end_ = end;
+        return true;
+    }
+    return false;
+}
+
+//! Steps the progress by the items done since last call.
+void report (Shared & sh, Progress & progress, int64_t & reported)
+{
+    int64_t done = 0;
+    foreach (Worker * w, sh.workers_) {
+        done += w->done_.loadAcquire ();
+    }
+    bool b_continue = true;
+    if (done > reported) {
+        b_continue = progress.step (done - reported);
+        reported = done;
+    }
+    if (!b_continue || progress.shouldStop ()) {
+        sh.stop_.fetchAndStoreOrdered (1);
+    }
+}
+
+//! The loop executed by each worker; progress is NULL except for the caller.
+void workerLoop (
+        Shared & sh, int index, Progress * progress, int64_t & reported)
+{
+    Worker * self = sh.workers_.at (index);
+    int64_t chunk = 1;
+    QElapsedTimer timer;
+
+    for (;;) {
+        // a plain load; the line is only written when a stop is requested
+        if (sh.stop_.load () != 0) break;
+
+        int64_t begin;
+        int64_t end;
+        if (!takeChunk (self, chunk, begin, end)) {
+            if (!steal (sh, index)) break;
+            continue;
+        }
+
+        timer.start ();
+        bool b_continue = sh.body_ (begin, end, sh.user_data_);
+        int64_t elapsed = timer.nsecsElapsed ();
+
+        self->done_.fetchAndAddRelease (end - begin);
+        if (!b_continue) {
+            sh.stop_.fetchAndStoreOrdered (1);
+        }
+
+        // scale the chunk towards the target duration
+        if (elapsed <= 0) {
+            chunk = chunk * 2;
+        } else {
+            double scale = (double)sh.target_ns_ / (double)elapsed;
+            scale = qBound (0.5, scale, 2.0);
+            chunk = (int64_t)(chunk * scale);
+        }
+        chunk = qBound ((int64_t)1, chunk, (int64_t)ProgressParallel::MAX_CHUNK);
+
+        if (progress != NULL) {
+            report (sh, *progress, reported);
+        }
+    }
+}
+
+//! Runs a worker loop in a pool thread.
+class WorkerTask : public QRunnable {
+public:
+    WorkerTask (const QSharedPointer<Shared> & shared, int index) :
+        QRunnable (),
+        shared_(shared),
+        index_(index)
+    {}
+
+    virtual void run () {
+        Worker * self = shared_->workers_.at (index_);
+        if (!self->state_.testAndSetOrdered (0, 1)) {
+            // the caller finished without us
+            return;
+        }
+        int64_t unused = 0;
+        workerLoop (*shared_, index_, NULL, unused);
+        shared_->finished_.release (1);
+    }
+
+private:
+    QSharedPointer<Shared> shared_;
+    int index_;
+};
+
+} // namespace
+
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param body The function that processes a chunk of items; it is
+ *             called from several threads at the same time.
+ * @param user_data Passed to the body.
+ */
+ProgressParallel::ProgressParallel (KbBody body, void * user_data) :
+    body_(body),
+    user_data_(user_data),
+    thread_count_(0),
+    target_ns_(1000000)
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressParallel::~ProgressParallel ()
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The items are reported as steps of the top portion of @a progress,
+ * which must be initialized. The method returns after all threads
+ * have stopped.
+ *
+ * @param progress The instance used for reporting and for stop requests.
+ * @param begin First index.
+ * @param end One past the last index.
+ * @return true if all items were processed, false if the loop was stopped
+ */
+bool ProgressParallel::run (Progress & progress, int64_t begin, int64_t end)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (!progress.isInitialized () || (body_ == NULL)) {
+        PROGRESS_DEBUGM ("  parallel loop needs an initialized progress "
+                         "and a body\n");
+        PROGRESS_TRACE_EXIT;
+        return false;
+    }
+    if (end <= begin) {
+        PROGRESS_TRACE_EXIT;
+        return !progress.shouldStop ();
+    }
+
+    int64_t count = end - begin;
+    int threads = thread_count_ > 0 ? thread_count_ : QThread::idealThreadCount ();
+    if (threads < 1) threads = 1;
+    if (threads > count) threads = (int)count;
+
+    QSharedPointer<Shared> shared (new Shared);
+    shared->body_ = body_;
+    shared->user_data_ = user_data_;
+    shared->target_ns_ = target_ns_;
+    shared->workers_.reserve (threads);
+    for (int i = 0; i < threads; ++i) {
+        Worker * w = new Worker;
+        w->next_ = begin + (count * i) / threads;
+        w->end_ = begin + (count * (i + 1)) / threads;
+        shared->workers_.append (w);
+    }
+    if (progress.shouldStop ()) {
+        shared->stop_.fetchAndStoreOrdered (1);
+    }
+
+    // the caller is worker 0
+    QThreadPool * pool = QThreadPool::globalInstance ();
+    for (int i = 1; i < threads; ++i) {
+        pool->start (new WorkerTask (shared, i));
+    }
+    int64_t reported = 0;
+    shared->workers_.at (0)->state_.fetchAndStoreOrdered (1);
+    workerLoop (*shared, 0, &progress, reported);
+
+    // cancel the workers that did not start and wait for the others;
+    // meanwhile keep reporting and forwarding stop requests
+    int started = 0;
+    for (int i = 1; i < threads; ++i) {
+        if (!shared->workers_.at (i)->state_.testAndSetOrdered (0, 2)) {
+            ++started;
+        }
+    }
+    int wait_ms = (int)qBound ((int64_t)1, target_ns_ / 1000000, (int64_t)100);
+    while (!shared->finished_.tryAcquire (started, wait_ms)) {
+        report (*shared, progress, reported);
+    }
+
+    // account for the chunks finished after our last report
+    report (*shared, progress, reported);
+
+    bool b_ret = (reported == count);
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
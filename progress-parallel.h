@@ -0,0 +1,106 @@
+/**
+ * @file progress-parallel.h
+ * @brief Declarations for ProgressParallel class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_PARALLEL_H_INCLUDE
+#define GUARD_PROGRESS_PARALLEL_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <stdint.h>
+
+class Progress;
+
+//! Runs a loop over a range of indices on several threads, reporting progress.
+class PROGRESS_EXPORT ProgressParallel {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+public:
+
+    //! Callback that processes the items in [begin, end);
+    //! return false to stop the loop.
+    typedef bool (*KbBody) (
+            int64_t begin,
+            int64_t end,
+            void * user_data);
+
+    //! Upper limit for the number of items in a chunk.
+    enum { MAX_CHUNK = 1 << 24 };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    KbBody body_; /**< the function that does the work */
+    void * user_data_; /**< passed to body_ */
+    int thread_count_; /**< number of threads, including the caller */
+    int64_t target_ns_; /**< desired duration of a chunk */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor.
+    explicit ProgressParallel (
+            KbBody body,
+            void * user_data = NULL);
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressParallel ();
+
+
+    //! Number of threads, including the caller; 0 or less for automatic.
+    inline int
+    threadCount () const {
+        return thread_count_;
+    }
+
+    //! Number of threads, including the caller; 0 or less for automatic.
+    inline void
+    setThreadCount (int value) {
+        thread_count_ = value;
+    }
+
+
+    //! Desired duration of a chunk in nanoseconds.
+    inline int64_t
+    targetChunkTime () const {
+        return target_ns_;
+    }
+
+    //! Desired duration of a chunk in nanoseconds.
+    inline void
+    setTargetChunkTime (int64_t value) {
+        target_ns_ = value > 0 ? value : 1;
+    }
+
+
+    //! Process the items in [begin, end); false if the loop was stopped.
+    bool
+    run (
+            Progress & progress,
+            int64_t begin,
+            int64_t end);
+
+}; // class ProgressParallel
+
+#endif // GUARD_PROGRESS_PARALLEL_H_INCLUDE
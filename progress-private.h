@@ -11,6 +11,8 @@
 #define GUARD_PROGRESS_PRIVATE_H_INCLUDE
 
 #include <progress/progress-config.h>
+#include <QByteArray>
+#include <stdint.h>
 
 #ifndef DEBUG_OFF
 #   define DEBUG_OFF 0
@@ -42,4 +44,44 @@
 static inline void black_hole (...)
 {}
 
+//! Append an unsigned variable length integer (7 bits per byte).
+static inline void progressAppendVarint (QByteArray & out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.append ((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append ((char)value);
+}
+
+//! Append a signed variable length integer (zig-zag).
+static inline void progressAppendSigned (QByteArray & out, int64_t value)
+{
+    progressAppendVarint (out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+//! Read an unsigned variable length integer; false on truncated input.
+static inline bool progressReadVarint (
+        const QByteArray & in, int & pos, uint64_t & value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size ()) return false;
+        uint8_t byte = (uint8_t)in.at (pos++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+//! Read a zig-zag encoded integer; false on truncated input.
+static inline bool progressReadSigned (
+        const QByteArray & in, int & pos, int64_t & value)
+{
+    uint64_t raw;
+    if (!progressReadVarint (in, pos, raw)) return false;
+    value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
 #endif // GUARD_PROGRESS_PRIVATE_H_INCLUDE
@@ -0,0 +1,734 @@
+/**
+ * @file progress-remote.cc
+ * @brief Definitions for ProgressCoordinator and ProgressWorkerLink classes.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-remote.h"
+#include "progress.h"
+#include "progress-private.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+using namespace ProgressRemote;
+
+/**
+ * @class ProgressCoordinator
+ *
+ * Each worker process gets a share of the top portion of the
+ * coordinator's Progress by calling assign () with the id of the worker
+ * and the size of the share. As workers run concurrently their shares
+ * are summed: the caller should enter () a portion whose total is the
+ * sum of the sizes and the coordinator sets its progress to the sum of
+ * the shares (each share being the progress of the worker scaled
+ * to its size). Offsets are not needed.
+ *
+ * The coordinator is a QObject and serves the workers from the thread
+ * it lives in (which needs an event loop). All messages received in
+ * one read are applied before the progress is updated, and the update
+ * only costs a step () on the Progress, which applies the usual cutoff
+ * and granularity rules. Per-worker state is O(1) to update, so
+ * thousands of workers are handled by one coordinator.
+ *
+ * When stop () is called every worker receives a stop message right
+ * away. The stop flag of the Progress (setStop () or a callback) is
+ * also checked each time data arrives and every stopPollInterval ()
+ * milliseconds (100 by default), so a local request reaches the
+ * workers even when they are silent. Workers that connect later
+ * receive the message as soon as they connect.
+ */
+
+/**
+ * @class ProgressWorkerLink
+ *
+ * The link connects to the coordinator and, after attach (), reports
+ * the resolved progress of a Progress instance. It does not need an
+ * event loop: all socket operations are performed, without blocking,
+ * from report () (called by the subscriber that attach () adds).
+ *
+ * The subscriber uses the cutoff level and the granularity of the
+ * instance unless others are given to attach (). The link coalesces
+ * the signals: a message is sent at most once every flushInterval ()
+ * milliseconds and carries only the difference from what the
+ * coordinator already knows, as variable length integers.
+ *
+ * A stop message from the coordinator makes the callback return false,
+ * so the attached instance stops like it would for a local request.
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressCoordinator::ProgressCoordinator (Progress * progress, QObject * parent) :
+    QObject (parent),
+    progress_(progress),
+    sum_(0),
+    b_stop_sent_(false),
+    assignments_(),
+    peers_(),
+    local_server_(NULL),
+    tcp_server_(NULL),
+    stop_timer_(NULL)
+{
+    PROGRESS_TRACE_ENTRY;
+    stop_timer_ = new QTimer (this);
+    connect (stop_timer_, SIGNAL(timeout()), this, SLOT(pollStop()));
+    stop_timer_->start (100);
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressCoordinator::~ProgressCoordinator ()
+{
+    PROGRESS_TRACE_ENTRY;
+    foreach (const Peer & p, peers_) {
+        p.device_->disconnect (this);
+        p.device_->deleteLater ();
+    }
+    peers_.clear ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param name Path of the Unix domain socket or name of the pipe;
+ *             a stale socket with the same name is removed.
+ * @return true if the server is listening
+ */
+bool ProgressCoordinator::listenLocal (const QString & name)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (local_server_ == NULL) {
+        local_server_ = new QLocalServer (this);
+        connect (local_server_, SIGNAL(newConnection()),
+                 this, SLOT(newLocalConnection()));
+    } else {
+        local_server_->close ();
+    }
+
+    QLocalServer::removeServer (name);
+    bool b_ret = local_server_->listen (name);
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param port The port to use; 0 lets the system choose one
+ *             (see tcpPort()).
+ * @param b_any_address Listen on all interfaces (workers on other nodes);
+ *                      by default only localhost is used.
+ * @return true if the server is listening
+ */
+bool ProgressCoordinator::listenTcp (quint16 port, bool b_any_address)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (tcp_server_ == NULL) {
+        tcp_server_ = new QTcpServer (this);
+        connect (tcp_server_, SIGNAL(newConnection()),
+                 this, SLOT(newTcpConnection()));
+    } else {
+        tcp_server_->close ();
+    }
+
+    bool b_ret = tcp_server_->listen (
+                b_any_address ? QHostAddress::Any : QHostAddress::LocalHost,
+                port);
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+quint16 ProgressCoordinator::tcpPort () const
+{
+    if (tcp_server_ == NULL) return 0;
+    return tcp_server_->serverPort ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Assigning again the same worker changes the size of its share
+ * but keeps the progress it reported.
+ *
+ * @param worker_id The id the worker uses when connecting.
+ * @param size_in_parent The share of the top portion.
+ */
+void ProgressCoordinator::assign (int worker_id, int64_t size_in_parent)
+{
+    PROGRESS_TRACE_ENTRY;
+    if (!assignments_.contains (worker_id)) {
+        Assignment a;
+        a.size_in_parent_ = size_in_parent;
+        a.total_ = 0;
+        a.progress_ = 0;
+        a.share_ = 0;
+        assignments_.insert (worker_id, a);
+    } else {
+        Assignment & a = assignments_[worker_id];
+        a.size_in_parent_ = size_in_parent;
+        updateShare (a, a.total_ > 0 ?
+                         (a.progress_ * a.size_in_parent_) / a.total_ : 0);
+        progress_->step (0, sum_);
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int64_t ProgressCoordinator::workerShare (int worker_id) const
+{
+    QHash<int, Assignment>::const_iterator it = assignments_.constFind (worker_id);
+    if (it == assignments_.constEnd ()) return 0;
+    return it.value ().share_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::stop ()
+{
+    PROGRESS_TRACE_ENTRY;
+    progress_->setStop ();
+    checkStop ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProgressCoordinator::stopPollInterval () const
+{
+    return stop_timer_->isActive () ? stop_timer_->interval () : 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The timer needs the event loop of the thread the coordinator lives in.
+ *
+ * @param value Interval in milliseconds; 0 or less disables the polling.
+ */
+void ProgressCoordinator::setStopPollInterval (int value)
+{
+    if ((value <= 0) || b_stop_sent_) {
+        stop_timer_->stop ();
+    } else {
+        stop_timer_->start (value);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::pollStop ()
+{
+    checkStop ();
+    if (b_stop_sent_) {
+        stop_timer_->stop ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::newLocalConnection ()
+{
+    PROGRESS_TRACE_ENTRY;
+    while (local_server_->hasPendingConnections ()) {
+        addPeer (local_server_->nextPendingConnection ());
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::newTcpConnection ()
+{
+    PROGRESS_TRACE_ENTRY;
+    while (tcp_server_->hasPendingConnections ()) {
+        QTcpSocket * socket = tcp_server_->nextPendingConnection ();
+        socket->setSocketOption (QAbstractSocket::LowDelayOption, 1);
+        addPeer (socket);
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::addPeer (QIODevice * device)
+{
+    Peer p;
+    p.device_ = device;
+    p.worker_id_ = -1;
+    peers_.insert (device, p);
+
+    connect (device, SIGNAL(readyRead()), this, SLOT(peerReadyRead()));
+    connect (device, SIGNAL(disconnected()), this, SLOT(peerDisconnected()));
+
+    if (b_stop_sent_) {
+        char msg = (char)MSG_STOP;
+        device->write (&msg, 1);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::peerReadyRead ()
+{
+    QIODevice * device = qobject_cast<QIODevice *>(sender ());
+    QHash<QIODevice *, Peer>::iterator it = peers_.find (device);
+    if (it == peers_.end ()) return;
+
+    it.value ().buffer_.append (device->readAll ());
+    int64_t old_sum = sum_;
+    parse (it.value ());
+
+    // one update for all the messages in this read
+    if (sum_ != old_sum) {
+        progress_->step (0, sum_);
+    }
+    checkStop ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::peerDisconnected ()
+{
+    PROGRESS_TRACE_ENTRY;
+    QIODevice * device = qobject_cast<QIODevice *>(sender ());
+    // the share of the worker is kept
+    if (peers_.remove (device) > 0) {
+        device->deleteLater ();
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Incomplete messages are left in the buffer; a malformed message
+ * closes the connection.
+ *
+ * @param peer The peer that received data.
+ */
+void ProgressCoordinator::parse (Peer & peer)
+{
+    const QByteArray & in = peer.buffer_;
+    int pos = 0;
+    int consumed = 0;
+    bool b_error = false;
+
+    while (pos < in.size ()) {
+        int op = (uint8_t)in.at (pos++);
+        uint64_t uvalue = 0;
+        int64_t svalue = 0;
+        bool b_complete = true;
+        switch (op) {
+        case MSG_HELLO:
+        case MSG_TOTAL:
+            b_complete = progressReadVarint (in, pos, uvalue);
+            break;
+        case MSG_DELTA:
+            b_complete = progressReadSigned (in, pos, svalue);
+            break;
+        case MSG_DONE:
+            break;
+        default:
+            b_error = true;
+        }
+        if (b_error || !b_complete) break;
+        consumed = pos;
+
+        if (op == MSG_HELLO) {
+            peer.worker_id_ = (int)uvalue;
+            if (!assignments_.contains (peer.worker_id_)) {
+                PROGRESS_DEBUGM ("  worker %d has no assignment\n",
+                                 peer.worker_id_);
+            }
+            continue;
+        }
+
+        QHash<int, Assignment>::iterator it = assignments_.find (peer.worker_id_);
+        if (it == assignments_.end ()) continue;
+        Assignment & a = it.value ();
+
+        if (op == MSG_TOTAL) {
+            a.total_ = (int64_t)uvalue;
+        } else if (op == MSG_DELTA) {
+            a.progress_ += svalue;
+        } else {
+            a.progress_ = a.total_;
+            updateShare (a, a.size_in_parent_);
+            continue;
+        }
+        updateShare (a, a.total_ > 0 ?
+                         (a.progress_ * a.size_in_parent_) / a.total_ : 0);
+    }
+
+    if (b_error) {
+        PROGRESS_DEBUGM ("  malformed message from worker %d\n", peer.worker_id_);
+        peer.buffer_.clear ();
+        peer.device_->close ();
+    } else {
+        peer.buffer_.remove (0, consumed);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::updateShare (Assignment & a, int64_t share)
+{
+    if (share < 0) share = 0;
+    if (share > a.size_in_parent_) share = a.size_in_parent_;
+    sum_ += share - a.share_;
+    a.share_ = share;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressCoordinator::checkStop ()
+{
+    if (b_stop_sent_ || !progress_->shouldStop ()) return;
+
+    b_stop_sent_ = true;
+    char msg = (char)MSG_STOP;
+    foreach (const Peer & p, peers_) {
+        p.device_->write (&msg, 1);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressWorkerLink::ProgressWorkerLink () :
+    local_socket_(NULL),
+    tcp_socket_(NULL),
+    progress_(NULL),
+    subscriber_id_(0),
+    sent_total_(0),
+    sent_progress_(0),
+    pending_total_(0),
+    pending_progress_(0),
+    flush_interval_ms_(100),
+    last_flush_(),
+    b_stop_received_(false)
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressWorkerLink::~ProgressWorkerLink ()
+{
+    PROGRESS_TRACE_ENTRY;
+    detach ();
+    disconnect ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param name Path of the Unix domain socket or name of the pipe.
+ * @param worker_id The id the coordinator used in assign ().
+ * @param timeout_ms How long to wait for the connection.
+ * @return true if connected
+ */
+bool ProgressWorkerLink::connectLocal (
+        const QString & name, int worker_id, int timeout_ms)
+{
+    PROGRESS_TRACE_ENTRY;
+    disconnect ();
+
+    local_socket_ = new QLocalSocket ();
+    local_socket_->connectToServer (name);
+    if (!local_socket_->waitForConnected (timeout_ms)) {
+        delete local_socket_;
+        local_socket_ = NULL;
+        PROGRESS_TRACE_EXIT;
+        return false;
+    }
+
+    QByteArray hello;
+    hello.append ((char)MSG_HELLO);
+    progressAppendVarint (hello, (uint64_t)worker_id);
+    bool b_ret = send (hello);
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param host Name or address of the coordinator.
+ * @param port The port of the coordinator.
+ * @param worker_id The id the coordinator used in assign ().
+ * @param timeout_ms How long to wait for the connection.
+ * @return true if connected
+ */
+bool ProgressWorkerLink::connectTcp (
+        const QString & host, quint16 port, int worker_id, int timeout_ms)
+{
+    PROGRESS_TRACE_ENTRY;
+    disconnect ();
+
+    tcp_socket_ = new QTcpSocket ();
+    tcp_socket_->connectToHost (host, port);
+    if (!tcp_socket_->waitForConnected (timeout_ms)) {
+        delete tcp_socket_;
+        tcp_socket_ = NULL;
+        PROGRESS_TRACE_EXIT;
+        return false;
+    }
+    tcp_socket_->setSocketOption (QAbstractSocket::LowDelayOption, 1);
+
+    QByteArray hello;
+    hello.append ((char)MSG_HELLO);
+    progressAppendVarint (hello, (uint64_t)worker_id);
+    bool b_ret = send (hello);
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProgressWorkerLink::isConnected () const
+{
+    if (local_socket_ != NULL) {
+        return local_socket_->state () == QLocalSocket::ConnectedState;
+    }
+    if (tcp_socket_ != NULL) {
+        return tcp_socket_->state () == QAbstractSocket::ConnectedState;
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressWorkerLink::disconnect ()
+{
+    PROGRESS_TRACE_ENTRY;
+    if (device () != NULL) {
+        flush ();
+    }
+    if (local_socket_ != NULL) {
+        local_socket_->disconnectFromServer ();
+        if (local_socket_->state () != QLocalSocket::UnconnectedState) {
+            local_socket_->waitForDisconnected (1000);
+        }
+        delete local_socket_;
+        local_socket_ = NULL;
+    }
+    if (tcp_socket_ != NULL) {
+        tcp_socket_->disconnectFromHost ();
+        if (tcp_socket_->state () != QAbstractSocket::UnconnectedState) {
+            tcp_socket_->waitForDisconnected (1000);
+        }
+        delete tcp_socket_;
+        tcp_socket_ = NULL;
+    }
+    sent_total_ = 0;
+    sent_progress_ = 0;
+    pending_total_ = 0;
+    pending_progress_ = 0;
+    b_stop_received_ = false;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The subscriber uses the cutoff level and the granularity of the
+ * instance, as they are at the time of the call.
+ *
+ * @param progress The instance to report.
+ */
+void ProgressWorkerLink::attach (Progress * progress)
+{
+    attach (progress, progress->cutoffLevel (), progress->granularity ());
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The link adds itself as a subscriber, so the callbacks and the user
+ * data of the instance remain available to the application.
+ *
+ * @param progress The instance to report.
+ * @param cutoff_level Deepest stack for which the link is signaled.
+ * @param granularity Minimum advance between two signals.
+ */
+void ProgressWorkerLink::attach (
+        Progress * progress, int cutoff_level, int64_t granularity)
+{
+    PROGRESS_TRACE_ENTRY;
+    detach ();
+    progress_ = progress;
+    subscriber_id_ = progress_->addSubscriber (
+                progressSignal, this, cutoff_level, granularity);
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressWorkerLink::detach ()
+{
+    PROGRESS_TRACE_ENTRY;
+    if (progress_ != NULL) {
+        progress_->removeSubscriber (subscriber_id_);
+        subscriber_id_ = 0;
+        progress_ = NULL;
+    }
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param total The total of the worker.
+ * @param progress The progress of the worker (same units as total).
+ * @return false if the coordinator asked the workers to stop
+ */
+bool ProgressWorkerLink::report (int64_t total, int64_t progress)
+{
+    pending_total_ = total;
+    pending_progress_ = progress;
+
+    // always send the last value without delay
+    if (!last_flush_.isValid () ||
+            (progress >= total) ||
+            (last_flush_.elapsed () >= flush_interval_ms_)) {
+        flush ();
+    }
+    return !b_stop_received_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @return false if the link is not connected
+ */
+bool ProgressWorkerLink::flush ()
+{
+    if (device () == NULL) return false;
+
+    QByteArray msg;
+    if ((pending_total_ != sent_total_) && (pending_total_ > 0)) {
+        msg.append ((char)MSG_TOTAL);
+        progressAppendVarint (msg, (uint64_t)pending_total_);
+        sent_total_ = pending_total_;
+    }
+    int64_t delta = pending_progress_ - sent_progress_;
+    if (delta != 0) {
+        msg.append ((char)MSG_DELTA);
+        progressAppendSigned (msg, delta);
+        sent_progress_ = pending_progress_;
+    }
+
+    bool b_ret = true;
+    if (msg.size () > 0) {
+        b_ret = send (msg);
+    }
+    last_flush_.start ();
+    poll ();
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The pending values are sent first and the method waits for the
+ * data to be written.
+ *
+ * @return false if the link is not connected
+ */
+bool ProgressWorkerLink::done ()
+{
+    PROGRESS_TRACE_ENTRY;
+    if (!flush ()) {
+        PROGRESS_TRACE_EXIT;
+        return false;
+    }
+    char msg = (char)MSG_DONE;
+    bool b_ret = send (QByteArray (&msg, 1));
+    if (b_ret) {
+        device ()->waitForBytesWritten (1000);
+    }
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+QIODevice * ProgressWorkerLink::device () const
+{
+    if (local_socket_ != NULL) return local_socket_;
+    return tcp_socket_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProgressWorkerLink::send (const QByteArray & data)
+{
+    if (local_socket_ != NULL) {
+        if (local_socket_->write (data) != data.size ()) return false;
+        local_socket_->flush ();
+        return true;
+    }
+    if (tcp_socket_ != NULL) {
+        if (tcp_socket_->write (data) != data.size ()) return false;
+        tcp_socket_->flush ();
+        return true;
+    }
+    return false;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressWorkerLink::poll ()
+{
+    QIODevice * d = device ();
+    if (d == NULL) return;
+
+    d->waitForReadyRead (0);
+    QByteArray incoming = d->readAll ();
+    if (incoming.contains ((char)MSG_STOP)) {
+        b_stop_received_ = true;
+    }
+
+    if (b_stop_received_ && (progress_ != NULL)) {
+        progress_->setStop ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProgressWorkerLink::progressSignal (
+        int64_t total_size, int64_t progress, const QString & status,
+        void * level_data, void * global_data)
+{
+    Q_UNUSED(status);
+    Q_UNUSED(level_data);
+    ProgressWorkerLink * link = static_cast<ProgressWorkerLink *>(global_data);
+    return link->report (total_size, progress);
+}
+/* ========================================================================= */
@@ -0,0 +1,358 @@
+/**
+ * @file progress-remote.h
+ * @brief Declarations for ProgressCoordinator and ProgressWorkerLink classes
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_REMOTE_H_INCLUDE
+#define GUARD_PROGRESS_REMOTE_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <stdint.h>
+
+class Progress;
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QLocalServer;
+class QLocalSocket;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+QT_END_NAMESPACE
+
+//! Messages exchanged by ProgressCoordinator and ProgressWorkerLink.
+namespace ProgressRemote {
+
+    //! Sent by the worker.
+    enum WorkerMessage {
+        MSG_HELLO = 1, /**< worker id (varint); first message */
+        MSG_TOTAL, /**< total of the worker (varint) */
+        MSG_DELTA, /**< change in the progress of the worker (zig-zag) */
+        MSG_DONE /**< the worker completed its portion */
+    };
+
+    //! Sent by the coordinator.
+    enum CoordinatorMessage {
+        MSG_STOP = 1 /**< the worker should stop */
+    };
+
+} // namespace ProgressRemote
+
+
+//! Aggregates the progress of remote workers into a Progress instance.
+class PROGRESS_EXPORT ProgressCoordinator : public QObject {
+    Q_OBJECT
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+    //! A portion assigned to a worker.
+    struct Assignment {
+        int64_t size_in_parent_; /**< share of the top portion */
+        int64_t total_; /**< total reported by the worker */
+        int64_t progress_; /**< progress reported by the worker */
+        int64_t share_; /**< current contribution to the top portion */
+    };
+
+    //! A connected worker.
+    struct Peer {
+        QIODevice * device_; /**< the socket */
+        int worker_id_; /**< -1 until hello is received */
+        QByteArray buffer_; /**< bytes not yet parsed */
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    Progress * progress_; /**< the instance that receives the aggregate */
+    int64_t sum_; /**< sum of the shares of all workers */
+    bool b_stop_sent_; /**< workers were told to stop */
+
+    QHash<int, Assignment> assignments_; /**< by worker id */
+    QHash<QIODevice *, Peer> peers_; /**< connected workers */
+
+    QLocalServer * local_server_;
+    QTcpServer * tcp_server_;
+    QTimer * stop_timer_; /**< polls the stop flag of the progress */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; progress must be initialized and outlive the coordinator.
+    explicit ProgressCoordinator (
+            Progress * progress,
+            QObject * parent = NULL);
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressCoordinator ();
+
+
+    //! Accept workers on a local socket (Unix domain socket or pipe).
+    bool
+    listenLocal (
+            const QString & name);
+
+    //! Accept workers on a localhost TCP port (0 for any).
+    bool
+    listenTcp (
+            quint16 port,
+            bool b_any_address = false);
+
+    //! Port used by the TCP server.
+    quint16
+    tcpPort () const;
+
+
+    //! Give a worker a share of the top portion of the progress.
+    void
+    assign (
+            int worker_id,
+            int64_t size_in_parent);
+
+    //! Number of workers that are connected.
+    inline int
+    connectedCount () const {
+        return peers_.size ();
+    }
+
+    //! Current share of a worker (in units of the top portion).
+    int64_t
+    workerShare (
+            int worker_id) const;
+
+
+    //! Ask all workers to stop (also sets the stop flag of the progress).
+    void
+    stop ();
+
+    //! How often the stop flag of the progress is checked (milliseconds).
+    int
+    stopPollInterval () const;
+
+    //! How often the stop flag of the progress is checked; 0 to disable.
+    void
+    setStopPollInterval (
+            int value);
+
+
+private slots:
+
+    //! A worker connected to the local socket.
+    void
+    newLocalConnection ();
+
+    //! A worker connected to the TCP port.
+    void
+    newTcpConnection ();
+
+    //! A worker sent data.
+    void
+    peerReadyRead ();
+
+    //! A worker went away.
+    void
+    peerDisconnected ();
+
+    //! The stop timer fired.
+    void
+    pollStop ();
+
+private:
+
+    //! Start tracking a new connection.
+    void
+    addPeer (
+            QIODevice * device);
+
+    //! Parse all complete messages from a peer.
+    void
+    parse (
+            Peer & peer);
+
+    //! Update the share of a worker and the progress.
+    void
+    updateShare (
+            Assignment & a,
+            int64_t share);
+
+    //! Tell the workers to stop if the progress was asked to stop.
+    void
+    checkStop ();
+
+}; // class ProgressCoordinator
+
+
+//! Reports the progress of a worker to a ProgressCoordinator.
+class PROGRESS_EXPORT ProgressWorkerLink {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    QLocalSocket * local_socket_;
+    QTcpSocket * tcp_socket_;
+    Progress * progress_; /**< attached instance (may be NULL) */
+    int subscriber_id_; /**< our subscriber in progress_ */
+
+    int64_t sent_total_; /**< last total that was sent */
+    int64_t sent_progress_; /**< progress the coordinator knows about */
+    int64_t pending_total_; /**< latest total */
+    int64_t pending_progress_; /**< latest progress */
+
+    int flush_interval_ms_; /**< minimum time between messages */
+    QElapsedTimer last_flush_;
+    bool b_stop_received_;
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; the link is not connected.
+    ProgressWorkerLink ();
+
+    //! Destructor; detaches and disconnects.
+    virtual
+    ~ProgressWorkerLink ();
+
+
+    //! Connect to a coordinator on a local socket.
+    bool
+    connectLocal (
+            const QString & name,
+            int worker_id,
+            int timeout_ms = 5000);
+
+    //! Connect to a coordinator over TCP.
+    bool
+    connectTcp (
+            const QString & host,
+            quint16 port,
+            int worker_id,
+            int timeout_ms = 5000);
+
+    //! Tell if the link is connected.
+    bool
+    isConnected () const;
+
+    //! Disconnect (pending progress is sent first).
+    void
+    disconnect ();
+
+
+    //! Report the progress of this instance using its cutoff and granularity.
+    void
+    attach (
+            Progress * progress);
+
+    //! Report the progress of this instance using given filters.
+    void
+    attach (
+            Progress * progress,
+            int cutoff_level,
+            int64_t granularity);
+
+    //! Stop reporting the progress of attached instance.
+    void
+    detach ();
+
+
+    //! Minimum time between two messages in milliseconds.
+    inline int
+    flushInterval () const {
+        return flush_interval_ms_;
+    }
+
+    //! Minimum time between two messages in milliseconds.
+    inline void
+    setFlushInterval (int value) {
+        flush_interval_ms_ = value;
+    }
+
+
+    //! Record new values; sends them if the flush interval elapsed.
+    bool
+    report (
+            int64_t total,
+            int64_t progress);
+
+    //! Send the pending values now.
+    bool
+    flush ();
+
+    //! Tell the coordinator that this worker completed its portion.
+    bool
+    done ();
+
+    //! Tell if the coordinator asked the workers to stop.
+    inline bool
+    stopReceived () const {
+        return b_stop_received_;
+    }
+
+private:
+
+    //! The socket in use (NULL if not connected).
+    QIODevice *
+    device () const;
+
+    //! Write bytes and push them to the system without blocking.
+    bool
+    send (
+            const QByteArray & data);
+
+    //! Read the messages from the coordinator without blocking.
+    void
+    poll ();
+
+    //! The subscriber added by attach ().
+    static bool
+    progressSignal (
+            int64_t total_size,
+            int64_t progress,
+            const QString & status,
+            void * level_data,
+            void * global_data);
+
+    Q_DISABLE_COPY(ProgressWorkerLink)
+
+}; // class ProgressWorkerLink
+
+#endif // GUARD_PROGRESS_REMOTE_H_INCLUDE
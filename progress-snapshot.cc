@@ -0,0 +1,168 @@
+/**
+ * @file progress-snapshot.cc
+ * @brief Definitions for ProgressSnapshot class.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-snapshot.h"
+#include "progress-private.h"
+#include <QByteArray>
+#include <atomic>
+#include <string.h>
+
+/**
+ * @class ProgressSnapshot
+ *
+ * The snapshot is a sequence lock: the single writer (the thread that
+ * drives the Progress instance) makes the sequence odd, updates the
+ * values and makes it even again. Readers copy the values and retry
+ * if the sequence was odd or changed in the meantime. The writer never
+ * waits for the readers.
+ *
+ * The writer and the readers may come and go independently (a job's
+ * Progress may be destroyed before the exporter that reads it, or the
+ * other way around), so the snapshot is reference counted: the creator
+ * holds the first reference, Progress::setSnapshot() takes another one
+ * and each owner calls release () when it is done. A snapshot that is
+ * shared this way must be allocated with new. hasWriter () tells the
+ * readers if a Progress instance is still attached.
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressSnapshot::ProgressSnapshot () :
+    sequence_(0),
+    references_(1),
+    b_writer_(0)
+{
+    memset (&values_, 0, sizeof(values_));
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressSnapshot::~ProgressSnapshot ()
+{
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressSnapshot::ref ()
+{
+    references_.fetchAndAddOrdered (1);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param snapshot The snapshot to release; may be NULL.
+ */
+void ProgressSnapshot::release (ProgressSnapshot * snapshot)
+{
+    if (snapshot == NULL) return;
+    if (snapshot->references_.fetchAndAddOrdered (-1) == 1) {
+        delete snapshot;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProgressSnapshot::hasWriter () const
+{
+    return b_writer_.loadAcquire () != 0;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param value true when a Progress starts publishing, false when it stops
+ */
+void ProgressSnapshot::setWriter (bool value)
+{
+    b_writer_.fetchAndStoreOrdered (value ? 1 : 0);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressSnapshot::Values & ProgressSnapshot::beginUpdate ()
+{
+    // the only writer; no read-modify-write is needed
+    sequence_.store (sequence_.load () + 1);
+    // the odd sequence is visible before any of the new values
+    std::atomic_thread_fence (std::memory_order_release);
+    return values_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressSnapshot::endUpdate ()
+{
+    sequence_.storeRelease (sequence_.load () + 1);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The label is truncated to LABEL_MAX - 1 bytes (at a character
+ * boundary).
+ *
+ * @param value new label
+ */
+void ProgressSnapshot::publishLabel (const QString & value)
+{
+    QByteArray utf8 = value.toUtf8 ();
+    int len = utf8.size ();
+    if (len >= LABEL_MAX) {
+        len = LABEL_MAX - 1;
+        // do not split a multi-byte sequence
+        while ((len > 0) && ((utf8.at (len) & 0xC0) == 0x80)) {
+            --len;
+        }
+    }
+
+    Values & v = beginUpdate ();
+    memcpy (v.label_, utf8.constData (), len);
+    v.label_[len] = 0;
+    endUpdate ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The reader only loads the sequence, so it never writes to the cache
+ * line that the writer updates.
+ *
+ * @param destination receives the values
+ */
+void ProgressSnapshot::read (Values & destination) const
+{
+    for (;;) {
+        int before = sequence_.loadAcquire ();
+        if ((before & 1) != 0) {
+            continue;
+        }
+        memcpy (&destination, &values_, sizeof(destination));
+        // the copy may not move past the second load
+        std::atomic_thread_fence (std::memory_order_acquire);
+        int after = sequence_.load ();
+        if (before == after) {
+            break;
+        }
+    }
+    destination.label_[LABEL_MAX - 1] = 0;
+}
+/* ========================================================================= */
@@ -0,0 +1,115 @@
+/**
+ * @file progress-snapshot.h
+ * @brief Declarations for ProgressSnapshot class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_SNAPSHOT_H_INCLUDE
+#define GUARD_PROGRESS_SNAPSHOT_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QAtomicInt>
+#include <QString>
+#include <stdint.h>
+
+//! State of a Progress instance as published for readers in other threads.
+class PROGRESS_EXPORT ProgressSnapshot {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+public:
+
+    //! Maximum number of bytes (UTF-8) kept from the label.
+    enum { LABEL_MAX = 128 };
+
+    //! The values that are published.
+    struct Values {
+        int64_t total_;
+        int64_t progress_;
+        int depth_;
+        int64_t emitted_;
+        int64_t suppressed_;
+        bool b_should_stop_;
+        char label_[LABEL_MAX];
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    QAtomicInt sequence_; /**< odd while an update is in progress */
+    Values values_; /**< the data guarded by the sequence */
+
+    QAtomicInt references_; /**< the last release () deletes the snapshot */
+    QAtomicInt b_writer_; /**< 1 while a Progress publishes here */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; all values are zero and the caller holds a reference.
+    ProgressSnapshot ();
+
+    //! Destructor.
+    ~ProgressSnapshot ();
+
+
+    //! Take a reference.
+    void
+    ref ();
+
+    //! Drop a reference; deletes the snapshot if it was the last one.
+    static void
+    release (
+            ProgressSnapshot * snapshot);
+
+    //! Tell if a Progress instance publishes into this snapshot.
+    bool
+    hasWriter () const;
+
+    //! Mark the start or the end of the publishing (see Progress::setSnapshot()).
+    void
+    setWriter (
+            bool value);
+
+
+    //! Start an update; only the owning Progress may call this.
+    Values &
+    beginUpdate ();
+
+    //! Publish the update started by beginUpdate().
+    void
+    endUpdate ();
+
+    //! Replace the label; only the owning Progress may call this.
+    void
+    publishLabel (
+            const QString & value);
+
+    //! Get a consistent copy of the values; never blocks the writer.
+    void
+    read (
+            Values & destination) const;
+
+private:
+
+    Q_DISABLE_COPY(ProgressSnapshot)
+}; // class ProgressSnapshot
+
+#endif // GUARD_PROGRESS_SNAPSHOT_H_INCLUDE
@@ -0,0 +1,371 @@
+/**
+ * @file progress-trace.cc
+ * @brief Definitions for ProgressRecorder and ProgressReplay classes.
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-trace.h"
+#include "progress.h"
+#include "progress-private.h"
+#include <QElapsedTimer>
+
+/**
+ * @class ProgressRecorder
+ *
+ * Attach the recorder to an instance using Progress::setRecorder().
+ * Each public call that changes the state of the instance is appended
+ * to the trace; calls made by the instance to itself (init () calling
+ * end (), for example) are not recorded. Portion and user data
+ * pointers and the callbacks are not part of the trace.
+ *
+ * The trace starts with the bytes `PRGT` and the format version.
+ * Each record is an op code byte followed by its arguments as
+ * variable length integers (7 bits per byte, signed values zig-zag
+ * encoded). A label is written in full only the first time it is seen
+ * (OP_LABEL); calls refer to it by its id (0 for an empty label).
+ */
+
+/**
+ * @class ProgressReplay
+ *
+ * The trace is decoded once by load (); run () then replays the calls
+ * on a fresh Progress instance with a callback that never asks to stop,
+ * so the time measured is spent in the library.
+ *
+ * The library can not count allocations by itself. A benchmark
+ * executable that replaces the global operator new can provide
+ * the count using setAllocationCounter ().
+ */
+/*  DEFINITIONS    ========================================================= */
+//
+//
+//
+//
+/*  DATA    ---------------------------------------------------------------- */
+
+//! Number of arguments (excluding the label) for each op code.
+static const int kArgumentCount[ProgressRecorder::OP_MAX] = {
+    0, // unused
+    0, // OP_LABEL (special)
+    1, // OP_INIT
+    2, // OP_INIT_STREAM
+    0, // OP_END
+    3, // OP_ENTER
+    3, // OP_ENTER_STREAM
+    1, // OP_GROW_STREAM
+    1, // OP_FINISH
+    2, // OP_STEP
+    0, // OP_STEP_ONE
+    2, // OP_SET_LEVEL
+    0, // OP_EMIT
+    1, // OP_CUTOFF
+    1, // OP_GRANULARITY
+    0, // OP_STOP
+    0, // OP_RESET_STOP
+};
+
+//! Magic bytes at the start of a trace.
+static const char kMagic[] = "PRGT";
+
+/*  DATA    ================================================================ */
+//
+//
+//
+//
+/*  FUNCTIONS    ----------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- */
+ProgressRecorder::ProgressRecorder () :
+    data_(),
+    labels_(),
+    b_anonymize_(false),
+    nesting_(0)
+{
+    PROGRESS_TRACE_ENTRY;
+    clear ();
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressRecorder::~ProgressRecorder ()
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void ProgressRecorder::clear ()
+{
+    data_.clear ();
+    labels_.clear ();
+    data_.append (kMagic, 4);
+    data_.append ((char)FORMAT_VERSION);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param op The kind of call.
+ * @param a First argument (if any).
+ * @param b Second argument (if any).
+ */
+void ProgressRecorder::record (OpCode op, int64_t a, int64_t b)
+{
+    // the most common call gets a record of its own
+    if ((op == OP_STEP) && (a == 1) && (b < 0)) {
+        data_.append ((char)OP_STEP_ONE);
+        return;
+    }
+
+    data_.append ((char)op);
+    int count = argumentCount (op);
+    if (count > 0) progressAppendSigned (data_, a);
+    if (count > 1) progressAppendSigned (data_, b);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * For OP_ENTER and OP_ENTER_STREAM the label is the second argument;
+ * for OP_INIT and OP_INIT_STREAM it is the first one.
+ *
+ * @param op The kind of call.
+ * @param label The label of the call.
+ * @param a First argument besides the label.
+ * @param b Second argument besides the label (if any).
+ * @param c Third argument besides the label (if any).
+ */
+void ProgressRecorder::recordLabelled (
+        OpCode op, const QString & label, int64_t a, int64_t b, int64_t c)
+{
+    // the definition must precede the call
+    int id = labelId (label);
+
+    data_.append ((char)op);
+    progressAppendVarint (data_, id);
+    int count = argumentCount (op);
+    if (count > 0) progressAppendSigned (data_, a);
+    if (count > 1) progressAppendSigned (data_, b);
+    if (count > 2) progressAppendSigned (data_, c);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProgressRecorder::argumentCount (int op)
+{
+    if ((op <= 0) || (op >= OP_MAX)) return -1;
+    return kArgumentCount[op];
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+bool ProgressRecorder::hasLabel (int op)
+{
+    return (op == OP_INIT) || (op == OP_INIT_STREAM) ||
+            (op == OP_ENTER) || (op == OP_ENTER_STREAM);
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int ProgressRecorder::labelId (const QString & label)
+{
+    if (label.isEmpty ()) return 0;
+
+    int id = labels_.value (label, 0);
+    if (id == 0) {
+        id = labels_.size () + 1;
+        labels_.insert (label, id);
+
+        QByteArray text = b_anonymize_ ?
+                    QString ("L%1").arg (id).toUtf8 () : label.toUtf8 ();
+        data_.append ((char)OP_LABEL);
+        progressAppendVarint (data_, text.size ());
+        data_.append (text);
+    }
+    return id;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressReplay::ProgressReplay () :
+    calls_(),
+    labels_(),
+    kb_allocations_(NULL)
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+ProgressReplay::~ProgressReplay ()
+{
+    PROGRESS_TRACE_ENTRY;
+    PROGRESS_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param trace The bytes produced by ProgressRecorder.
+ * @return false if the trace is malformed (nothing is loaded)
+ */
+bool ProgressReplay::load (const QByteArray & trace)
+{
+    PROGRESS_TRACE_ENTRY;
+    calls_.clear ();
+    labels_.clear ();
+
+    bool b_ret = false;
+    for (;;) {
+        if ((trace.size () < 5) || !trace.startsWith (kMagic) ||
+                (trace.at (4) != ProgressRecorder::FORMAT_VERSION)) {
+            PROGRESS_DEBUGM ("  not a progress trace\n");
+            break;
+        }
+
+        int pos = 5;
+        bool b_ok = true;
+        while (b_ok && (pos < trace.size ())) {
+            int op = (uint8_t)trace.at (pos++);
+            if (op == ProgressRecorder::OP_LABEL) {
+                uint64_t len;
+                b_ok = progressReadVarint (trace, pos, len) &&
+                        (len <= (uint64_t)(trace.size () - pos));
+                if (b_ok) {
+                    labels_.append (QString::fromUtf8 (
+                                        trace.constData () + pos, (int)len));
+                    pos += (int)len;
+                }
+                continue;
+            }
+
+            int count = ProgressRecorder::argumentCount (op);
+            if (count < 0) {
+                b_ok = false;
+                break;
+            }
+
+            Call c;
+            c.op_ = op;
+            c.label_ = 0;
+            c.a_ = c.b_ = c.c_ = 0;
+            if (ProgressRecorder::hasLabel (op)) {
+                uint64_t id;
+                b_ok = progressReadVarint (trace, pos, id) &&
+                        (id <= (uint64_t)labels_.size ());
+                c.label_ = (int)id;
+            }
+            if (b_ok && (count > 0)) b_ok = progressReadSigned (trace, pos, c.a_);
+            if (b_ok && (count > 1)) b_ok = progressReadSigned (trace, pos, c.b_);
+            if (b_ok && (count > 2)) b_ok = progressReadSigned (trace, pos, c.c_);
+            if (b_ok) calls_.append (c);
+        }
+
+        if (!b_ok) {
+            PROGRESS_DEBUGM ("  malformed progress trace\n");
+            calls_.clear ();
+            labels_.clear ();
+            break;
+        }
+
+        b_ret = true;
+        break;
+    }
+
+    PROGRESS_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+//! Callback used while replaying; never asks to stop.
+static bool replaySignal (
+        int64_t, int64_t, const QString &, void *, void *)
+{
+    return true;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param repetitions Number of times the whole trace is replayed.
+ * @return the measurements
+ */
+ProgressReplay::Result ProgressReplay::run (int repetitions) const
+{
+    PROGRESS_TRACE_ENTRY;
+    Result result;
+    result.calls_ = 0;
+    result.elapsed_ns_ = 0;
+    result.ns_per_call_ = 0.0;
+    result.signals_emitted_ = 0;
+    result.signals_suppressed_ = 0;
+    result.allocations_ = -1;
+
+    const QString empty;
+    Progress progress;
+    progress.setCallback (replaySignal);
+
+    int64_t alloc_start = kb_allocations_ != NULL ? kb_allocations_ () : 0;
+    QElapsedTimer timer;
+    timer.start ();
+
+    for (int r = 0; r < repetitions; ++r) {
+        foreach (const Call & c, calls_) {
+            const QString & label = c.label_ == 0 ? empty : labels_.at (c.label_ - 1);
+            switch (c.op_) {
+            case ProgressRecorder::OP_INIT:
+                progress.init (label, c.a_); break;
+            case ProgressRecorder::OP_INIT_STREAM:
+                progress.initStream (label, c.a_, c.b_); break;
+            case ProgressRecorder::OP_END:
+                progress.end (); break;
+            case ProgressRecorder::OP_ENTER:
+                progress.enter (c.a_, label, c.b_, c.c_); break;
+            case ProgressRecorder::OP_ENTER_STREAM:
+                progress.enterStream (c.a_, label, c.b_, c.c_); break;
+            case ProgressRecorder::OP_GROW_STREAM:
+                progress.growStream (c.a_); break;
+            case ProgressRecorder::OP_FINISH:
+                progress.finish (c.a_ != 0); break;
+            case ProgressRecorder::OP_STEP:
+                progress.step (c.a_, c.b_); break;
+            case ProgressRecorder::OP_STEP_ONE:
+                progress.step (); break;
+            case ProgressRecorder::OP_SET_LEVEL:
+                progress.setLevelCharact (c.a_, c.b_); break;
+            case ProgressRecorder::OP_EMIT:
+                progress.emitSigal (); break;
+            case ProgressRecorder::OP_CUTOFF:
+                progress.setCutoffLevel ((int)c.a_); break;
+            case ProgressRecorder::OP_GRANULARITY:
+                progress.setGranularity (c.a_); break;
+            case ProgressRecorder::OP_STOP:
+                progress.setStop (); break;
+            case ProgressRecorder::OP_RESET_STOP:
+                progress.resetStop (); break;
+            }
+        }
+        result.calls_ += calls_.size ();
+    }
+
+    result.elapsed_ns_ = timer.nsecsElapsed ();
+    if (kb_allocations_ != NULL) {
+        result.allocations_ = kb_allocations_ () - alloc_start;
+    }
+    if (result.calls_ > 0) {
+        result.ns_per_call_ = (double)result.elapsed_ns_ / result.calls_;
+    }
+    result.signals_emitted_ = progress.signalsEmitted ();
+    result.signals_suppressed_ = progress.signalsSuppressed ();
+
+    PROGRESS_TRACE_EXIT;
+    return result;
+}
+/* ========================================================================= */
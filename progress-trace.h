@@ -0,0 +1,295 @@
+/**
+ * @file progress-trace.h
+ * @brief Declarations for ProgressRecorder and ProgressReplay classes
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#ifndef GUARD_PROGRESS_TRACE_H_INCLUDE
+#define GUARD_PROGRESS_TRACE_H_INCLUDE
+
+#include <progress/progress-config.h>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <stdint.h>
+
+//! Records the calls made to a Progress instance in a compact binary form.
+class PROGRESS_EXPORT ProgressRecorder {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+public:
+
+    //! The kinds of records in a trace.
+    enum OpCode {
+        OP_LABEL = 1, /**< defines next label id: length, utf-8 bytes */
+        OP_INIT, /**< label, total_size */
+        OP_INIT_STREAM, /**< label, scale, estimate */
+        OP_END, /**< no arguments */
+        OP_ENTER, /**< parent_size, label, total_size, parent_offset */
+        OP_ENTER_STREAM, /**< parent_size, label, estimate, parent_offset */
+        OP_GROW_STREAM, /**< at_least */
+        OP_FINISH, /**< update_parent */
+        OP_STEP, /**< chunk_size, offset */
+        OP_STEP_ONE, /**< step (1, -1); no arguments */
+        OP_SET_LEVEL, /**< total_size, progress */
+        OP_EMIT, /**< no arguments */
+        OP_CUTOFF, /**< value */
+        OP_GRANULARITY, /**< value */
+        OP_STOP, /**< no arguments */
+        OP_RESET_STOP, /**< no arguments */
+
+        OP_MAX
+    };
+
+    //! Version of the format written by this class.
+    enum { FORMAT_VERSION = 1 };
+
+    //! Records only the outermost of nested calls (see Reentry).
+    class Scope {
+    public:
+        //! Enter a call; recorder may be NULL.
+        explicit Scope (ProgressRecorder * recorder) :
+            recorder_(recorder)
+        {
+            if (recorder_ != NULL) ++recorder_->nesting_;
+        }
+
+        //! Leave the call.
+        ~Scope () {
+            if (recorder_ != NULL) --recorder_->nesting_;
+        }
+
+        //! Tell if this call is to be recorded.
+        inline bool
+        active () const {
+            return (recorder_ != NULL) && (recorder_->nesting_ == 1);
+        }
+
+    private:
+        ProgressRecorder * recorder_;
+    };
+
+    //! Lets the calls made by a callback be recorded as outermost calls.
+    class Reentry {
+    public:
+        //! Leave the recorded call for a callback; recorder may be NULL.
+        explicit Reentry (ProgressRecorder * recorder) :
+            recorder_(recorder),
+            nesting_(0)
+        {
+            if (recorder_ != NULL) {
+                nesting_ = recorder_->nesting_;
+                recorder_->nesting_ = 0;
+            }
+        }
+
+        //! Back in the recorded call.
+        ~Reentry () {
+            if (recorder_ != NULL) recorder_->nesting_ = nesting_;
+        }
+
+    private:
+        ProgressRecorder * recorder_;
+        int nesting_;
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    QByteArray data_; /**< the trace */
+    QHash<QString, int> labels_; /**< label to id */
+    bool b_anonymize_; /**< replace labels by their ids */
+    int nesting_; /**< depth of Progress calls (see Scope) */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; creates an empty trace.
+    ProgressRecorder ();
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressRecorder ();
+
+
+    //! The trace recorded so far.
+    inline const QByteArray &
+    data () const {
+        return data_;
+    }
+
+    //! Discard the trace and start a new one.
+    void
+    clear ();
+
+
+    //! Labels are stored as `L<id>` instead of their text.
+    inline bool
+    anonymize () const {
+        return b_anonymize_;
+    }
+
+    //! Labels are stored as `L<id>` instead of their text.
+    inline void
+    setAnonymize (bool value) {
+        b_anonymize_ = value;
+    }
+
+
+    //! Append a call without label.
+    void
+    record (
+            OpCode op,
+            int64_t a = 0,
+            int64_t b = 0);
+
+    //! Append a call that has a label.
+    void
+    recordLabelled (
+            OpCode op,
+            const QString & label,
+            int64_t a,
+            int64_t b = 0,
+            int64_t c = 0);
+
+
+    //! Number of arguments (excluding the label) for each op code.
+    static int
+    argumentCount (
+            int op);
+
+    //! Tell if the op code has a label argument.
+    static bool
+    hasLabel (
+            int op);
+
+private:
+
+    //! Get the id of a label, defining it if needed; 0 for empty labels.
+    int
+    labelId (
+            const QString & label);
+
+    Q_DISABLE_COPY(ProgressRecorder)
+
+}; // class ProgressRecorder
+
+
+//! Runs a recorded trace against a Progress instance.
+class PROGRESS_EXPORT ProgressReplay {
+    //
+    //
+    //
+    //
+    /*  DEFINITIONS    ----------------------------------------------------- */
+
+public:
+
+    //! Returns the number of allocations performed so far in the process.
+    typedef int64_t (*KbAllocations) ();
+
+    //! The outcome of a run.
+    struct Result {
+        int64_t calls_; /**< number of replayed calls */
+        int64_t elapsed_ns_; /**< wall time for all calls */
+        double ns_per_call_; /**< elapsed_ns_ / calls_ */
+        int64_t signals_emitted_; /**< callbacks invoked */
+        int64_t signals_suppressed_; /**< changes dropped by the filters */
+        int64_t allocations_; /**< -1 if no counter was installed */
+    };
+
+private:
+
+    //! A decoded call.
+    struct Call {
+        int op_;
+        int label_;
+        int64_t a_;
+        int64_t b_;
+        int64_t c_;
+    };
+
+    /*  DEFINITIONS    ===================================================== */
+    //
+    //
+    //
+    //
+    /*  DATA    ------------------------------------------------------------ */
+
+private:
+
+    QVector<Call> calls_; /**< the decoded trace */
+    QStringList labels_; /**< labels by id - 1 */
+    KbAllocations kb_allocations_; /**< allocation counter (may be NULL) */
+
+    /*  DATA    ============================================================ */
+    //
+    //
+    //
+    //
+    /*  FUNCTIONS    ------------------------------------------------------- */
+
+public:
+
+    //! Constructor; creates an empty replay.
+    ProgressReplay ();
+
+    //! Destructor; releases all resources.
+    virtual
+    ~ProgressReplay ();
+
+
+    //! Decode a trace produced by ProgressRecorder.
+    bool
+    load (
+            const QByteArray & trace);
+
+    //! Number of calls in the loaded trace.
+    inline int
+    callCount () const {
+        return calls_.size ();
+    }
+
+
+    //! Function used to count allocations.
+    inline KbAllocations
+    allocationCounter () const {
+        return kb_allocations_;
+    }
+
+    //! Function used to count allocations.
+    inline void
+    setAllocationCounter (KbAllocations value) {
+        kb_allocations_ = value;
+    }
+
+
+    //! Replay the trace a number of times on a fresh instance.
+    Result
+    run (
+            int repetitions = 1) const;
+
+}; // class ProgressReplay
+
+#endif // GUARD_PROGRESS_TRACE_H_INCLUDE
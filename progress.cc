@@ -9,7 +9,11 @@
 
 #include "progress.h"
 #include "progress-private.h"
+#include "progress-histogram.h"
+#include "progress-snapshot.h"
+#include "progress-trace.h"
 #include <limits.h>
+#include <math.h>
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -47,13 +51,17 @@
     "    - tot_size_ = %"PRIi64"\n" \
     "    - progress_ = %"PRIi64"\t" \
     "    - user_data_ = %p\t" \
-    "    - current_status_ = <%s>\n",  \
+    "    - current_status_ = <%s>\n" \
+    "    - b_stream_ = %s\t" \
+    "    - stream_mark_ = %"PRIi64"\n",  \
     __p__.offset_in_parent_, \
     __p__.size_in_parent_, \
     __p__.tot_size_, \
     __p__.progress_, \
     (void*)__p__.user_data_, \
-    TMP_A(__p__.current_status_));
+    TMP_A(__p__.current_status_), \
+    __p__.b_stream_ ? "true" : "false", \
+    __p__.stream_mark_);
 #else
 #   define PORTION_DUMP(__t__, __p__)
 #endif
@@ -118,6 +126,24 @@
  * advance by at least that much to trigger a signal).
  * By default all levels emit signals and the granularity is 1.
  *
+ * Besides these two callbacks any number of subscribers may be added
+ * using addSubscriber (). Each has its own cutoff level, granularity
+ * and minimum interval between signals, so a log writer that wants
+ * a line every 5% and a progress bar that wants every 0.1% do not
+ * have to share a callback that fires at the finest rate. The progress
+ * is resolved once for all callbacks and the subscribers are only
+ * visited when the widest cutoff level and the smallest pending
+ * threshold of all of them allow a signal. When there is no callback,
+ * no subscriber within its cutoff level and no snapshot the progress
+ * is not resolved at all.
+ *
+ * Portions whose size is not known in advance (a stream, a directory walk)
+ * may be created using initStream () and enterStream (). For these the
+ * total size is only an "at least this much" estimate that can be raised
+ * using growStream () as discovery proceeds. The share such a portion
+ * reports to its parent is never decreasing and stays below its size
+ * in parent until the portion is finished (see streamShare ()).
+ *
  */
 /*  DEFINITIONS    ========================================================= */
 //
@@ -143,7 +169,19 @@ Progress::Progress () :
     current_status_(),
     user_data_(NULL),
     kb_simple_signal_(NULL),
-    kb_full_signal_(NULL)
+    kb_full_signal_(NULL),
+    subscribers_(),
+    subscriber_cutoff_(0),
+    subscriber_next_(INT64_MAX),
+    subscriber_depth_(-1),
+    next_subscriber_id_(1),
+    signals_emitted_(0),
+    signals_suppressed_(0),
+    snapshot_(NULL),
+    snapshot_next_(INT64_MIN),
+    histogram_(NULL),
+    clock_(),
+    recorder_(NULL)
 {
     PRGR_TRACE_ENTRY;
 
@@ -157,7 +195,9 @@ Progress::Progress () :
 Progress::~Progress ()
 {
     PRGR_TRACE_ENTRY;
+    recorder_ = NULL;
     end ();
+    setSnapshot (NULL);
     PRGR_TRACE_EXIT;
 }
 /* ========================================================================= */
@@ -178,6 +218,11 @@ Progress::~Progress ()
 bool Progress::init (const QString & title, int64_t total_size)
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->recordLabelled (
+                    ProgressRecorder::OP_INIT, title, total_size);
+    }
     bool b_ret = false;
     for (;;) {
         end ();
@@ -196,12 +241,22 @@ bool Progress::init (const QString & title, int64_t total_size)
         p.tot_size_ = total_size;
         p.user_data_ = NULL;
         p.current_status_ = title;
+        p.b_stream_ = false;
+        p.stream_mark_ = 0;
+        startPortion (p);
         stack_.push_front (p);
+        snapshot_next_ = INT64_MIN;
 
         current_status_ = title;
         prev_prog_ = 0;
+        for (QList<Subscriber>::iterator i = subscribers_.begin ();
+             i != subscribers_.end (); ++i) {
+            (*i).prev_prog_ = 0;
+        }
+        updateSubscriberGates ();
 
         b_should_stop_ = false;
+        publishLabel ();
 
         PRGR_DUMP("  initialized", (*this));
         PORTION_DUMP("  base portion", p);
@@ -219,10 +274,16 @@ bool Progress::init (const QString & title, int64_t total_size)
 void Progress::end ()
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (ProgressRecorder::OP_END);
+    }
     PRGR_DUMP("  before end()", (*this));
     stack_.clear ();
     b_should_stop_ = true;
     current_status_.clear ();
+    publishLabel ();
+    publishSnapshot (false);
     PRGR_TRACE_EXIT;
 }
 /* ========================================================================= */
@@ -241,6 +302,160 @@ void Progress::end ()
 void Progress::enter (
         int64_t parent_size, const QString &label, int64_t total_size,
         int64_t parent_offset, void * portion_data)
+{
+    PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->recordLabelled (
+                    ProgressRecorder::OP_ENTER, label,
+                    parent_size, total_size, parent_offset);
+    }
+    enterPortion (
+                parent_size, label, total_size,
+                parent_offset, portion_data, false);
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The function is the same as init () but the first portion is a
+ * streaming one: the total size is not known in advance.
+ *
+ * @param title The name of this job; will be shown when the subtasks
+ *              do not provide their own title.
+ * @param scale The total reported to the callbacks; the progress will be
+ *              in same units as this value.
+ * @param estimate The number of items known to exist at this time;
+ *                 0 if nothing is known.
+ * @return true if everything went fine
+ */
+bool Progress::initStream (
+        const QString & title, int64_t scale, int64_t estimate)
+{
+    PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->recordLabelled (
+                    ProgressRecorder::OP_INIT_STREAM, title, scale, estimate);
+    }
+    bool b_ret = false;
+    for (;;) {
+        if (estimate < 0) {
+            PRGR_DEBUG (
+                        "  estimate (%" PRIi64 ") must be a "
+                        "positive integer or 0\n", estimate);
+            end ();
+            break;
+        }
+
+        if (!init (title, scale)) {
+            break;
+        }
+
+        Portion & f = stack_.first ();
+        f.b_stream_ = true;
+        f.tot_size_ = estimate;
+
+        PORTION_DUMP("  base streaming portion", f);
+
+        b_ret = true;
+        break;
+    }
+
+    PRGR_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The function is the same as enter () but the new portion is a
+ * streaming one: the total size is not known in advance.
+ *
+ * If the instance was not initialized the method will do that
+ * using initStream () with @a parent_size as the scale.
+ *
+ * @param parent_size
+ * @param label
+ * @param estimate The number of items known to exist at this time;
+ *                 0 if nothing is known.
+ * @param parent_offset
+ * @param portion_data
+ */
+void Progress::enterStream (
+        int64_t parent_size, const QString &label, int64_t estimate,
+        int64_t parent_offset, void * portion_data)
+{
+    PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->recordLabelled (
+                    ProgressRecorder::OP_ENTER_STREAM, label,
+                    parent_size, estimate, parent_offset);
+    }
+    if (estimate < 0) {
+        PRGR_DEBUG (
+                    "  estimate (%" PRIi64 ") must be a "
+                    "positive integer or 0\n", estimate);
+        estimate = 0;
+    }
+    enterPortion (
+                parent_size, label, estimate,
+                parent_offset, portion_data, true);
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The portion that grows is the nearest streaming portion in the stack,
+ * so the estimate may be raised while a child portion (the processing
+ * of a discovered item, for example) is active. The estimate is never
+ * lowered, so calling this with the number of items discovered so far
+ * is always safe.
+ *
+ * @param at_least Lower bound for the number of items in the portion.
+ */
+void Progress::growStream (int64_t at_least)
+{
+    PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (ProgressRecorder::OP_GROW_STREAM, at_least);
+    }
+    for (;;) {
+        if (!isInitialized ()) {
+            PRGR_DEBUG (" can't grow a stream before initialization\n");
+            break;
+        }
+
+        QList<Portion>::iterator i_end = stack_.end ();
+        QList<Portion>::iterator i = stack_.begin ();
+        while ((i != i_end) && !(*i).b_stream_) {
+            ++i;
+        }
+        if (i == i_end) {
+            PRGR_DEBUG (" no streaming portion in the stack\n");
+            break;
+        }
+
+        Portion & s = *i;
+        if (at_least > s.tot_size_) {
+            s.tot_size_ = at_least;
+        }
+
+        PORTION_DUMP("  after growStream()", s);
+        break;
+    }
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void Progress::enterPortion (
+        int64_t parent_size, const QString &label, int64_t total_size,
+        int64_t parent_offset, void * portion_data, bool b_stream)
 {
     PRGR_TRACE_ENTRY;
     bool b_ret = false;
@@ -248,11 +463,16 @@ void Progress::enter (
 
         // special case when initialization is done via enter ()
         if (!isInitialized ()) {
-            if (!init (label, total_size)) {
+            if (b_stream) {
+                if (!initStream (label, parent_size, total_size)) {
+                    break;
+                }
+            } else if (!init (label, total_size)) {
                 break;
             }
+            // the root has no parent to take a default offset from
             Portion & f = stack_.first ();
-            f.offset_in_parent_ = parent_offset;
+            f.offset_in_parent_ = parent_offset < 0 ? 0 : parent_offset;
             f.user_data_ = portion_data;
 
             PORTION_DUMP("  init via enter(); altered first", f);
@@ -276,11 +496,16 @@ void Progress::enter (
         p.tot_size_ = total_size;
         p.user_data_ = portion_data;
         p.current_status_ = label;
+        p.b_stream_ = b_stream;
+        p.stream_mark_ = 0;
+        startPortion (p);
         stack_.push_front (p);
+        snapshot_next_ = INT64_MIN;
 
         // update the top label
         if (!label.isEmpty ()) {
             current_status_ = label;
+            publishLabel ();
         }
 
         PORTION_DUMP("  new in enter()", p);
@@ -291,7 +516,7 @@ void Progress::enter (
         break;
     }
     Q_UNUSED(b_ret);
-    PRGR_DUMP("  after enter()", (*this));
+    PRGR_DUMP("  after enterPortion()", (*this));
     PRGR_TRACE_EXIT;
 }
 /* ========================================================================= */
@@ -304,6 +529,10 @@ void Progress::enter (
 void Progress::finish (bool update_parent)
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (ProgressRecorder::OP_FINISH, update_parent ? 1 : 0);
+    }
     for (;;) {
         if (stack_.isEmpty ()) break;
 
@@ -315,12 +544,19 @@ void Progress::finish (bool update_parent)
         int64_t offset_in_parent = f.offset_in_parent_;
         int64_t size_in_parent = f.size_in_parent_;
 
+        if ((histogram_ != NULL) && (f.label_id_ >= 0)) {
+            histogram_->record (
+                        f.label_id_, clock_.nsecsElapsed () - f.started_ns_);
+        }
+
         // remove it from the list
         // Portion & f no longer valid
         stack_.pop_front ();
+        snapshot_next_ = INT64_MIN;
 
         if (b_update_title) {
             current_status_ = searchCurrentLabel ();
+            publishLabel ();
         }
 
         if (stack_.isEmpty ()) {
@@ -377,6 +613,10 @@ void Progress::finish (bool update_parent)
 bool Progress::step (int64_t chunk_size, int64_t offset)
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (ProgressRecorder::OP_STEP, chunk_size, offset);
+    }
     bool b_ret = false;
     for (;;) {
         if (stack_.isEmpty ()) {
@@ -421,6 +661,10 @@ bool Progress::step (int64_t chunk_size, int64_t offset)
 bool Progress::emitSigal()
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (ProgressRecorder::OP_EMIT);
+    }
 
     if (!isInitialized ()) {
         PRGR_DEBUG (" can't emit signal before initialization\n");
@@ -447,6 +691,11 @@ bool Progress::emitSigal()
 void Progress::setLevelCharact (int64_t total_size, int64_t progress)
 {
     PRGR_TRACE_ENTRY;
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (rec_scope.active ()) {
+        recorder_->record (
+                    ProgressRecorder::OP_SET_LEVEL, total_size, progress);
+    }
     if (!isInitialized ()) {
         PRGR_DEBUG (" can't set level characteristics before initialization\n");
         return;
@@ -456,12 +705,267 @@ void Progress::setLevelCharact (int64_t total_size, int64_t progress)
 
     f.tot_size_ = total_size;
     f.progress_ = progress;
+    snapshot_next_ = INT64_MIN;
 
     PORTION_DUMP("  after setLevelCharact()", f);
     PRGR_TRACE_EXIT;
 }
 /* ========================================================================= */
 
+/* ------------------------------------------------------------------------- */
+/**
+ * Once set, the instance writes its state into the snapshot when a
+ * portion is entered or finished and, in between, each time the
+ * progress advanced by at least granularity() since the last write.
+ * This holds even when the depth is past the cutoff level: the top
+ * portion is compared with a precomputed value, so most changes only
+ * cost that compare and only the ones that pass it resolve the stack.
+ * The snapshot is a sequence lock with this instance as the only
+ * writer, so readers never slow down step().
+ *
+ * The instance holds a reference to the snapshot (see
+ * ProgressSnapshot::release()) until it is destroyed or until another
+ * snapshot is set, so the reader may drop its own reference at any time.
+ *
+ * The method should not be called while the instance is used by
+ * another thread. Usually ProgressExporter::addProgress() calls it.
+ *
+ * @param value The snapshot to use; NULL to stop publishing.
+ */
+void Progress::setSnapshot (ProgressSnapshot * value)
+{
+    PRGR_TRACE_ENTRY;
+    if (value != NULL) {
+        value->ref ();
+    }
+    if (snapshot_ != NULL) {
+        snapshot_->setWriter (false);
+        ProgressSnapshot::release (snapshot_);
+    }
+    snapshot_ = value;
+    snapshot_next_ = INT64_MIN;
+    if (snapshot_ != NULL) {
+        snapshot_->setWriter (true);
+        publishLabel ();
+        publishSnapshot (false);
+    }
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Once set, each portion that has a label of its own records its
+ * wall time into the aggregator when it is finished. Portions that
+ * were already created when the aggregator was set are not recorded.
+ * An aggregator may be shared by instances used in different threads.
+ *
+ * @param value The aggregator to use; NULL to stop recording.
+ */
+void Progress::setHistogram (ProgressHistogram * value)
+{
+    PRGR_TRACE_ENTRY;
+    for (QList<Portion>::iterator i = stack_.begin (); i != stack_.end (); ++i) {
+        (*i).label_id_ = -1;
+    }
+    histogram_ = value;
+    if ((histogram_ != NULL) && !clock_.isValid ()) {
+        clock_.start ();
+    }
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The current cutoff level and granularity are recorded right away, so
+ * that a replay of the trace applies the same filters. Calls made by
+ * the callbacks are recorded in the order in which they happen.
+ *
+ * @param value The recorder to use; NULL to stop recording.
+ */
+void Progress::setRecorder (ProgressRecorder * value)
+{
+    PRGR_TRACE_ENTRY;
+    recorder_ = value;
+    if (recorder_ != NULL) {
+        recordSetting (SET_CUTOFF, cutoff_level_);
+        recordSetting (SET_GRANULARITY, granularity_);
+    }
+    PRGR_TRACE_EXIT;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The callback receives the resolved progress when all filters of
+ * the subscriber accept the change: the stack is no deeper than
+ * @a cutoff_level, the progress advanced by at least @a granularity
+ * since its last signal and at least @a interval_ms milliseconds
+ * elapsed since then. A subscriber with granularity 0 and
+ * an interval is only limited by time; note that such a subscriber
+ * makes each step read the clock. emitSigal () bypasses all filters.
+ *
+ * The callback gets the portion data as level_data and @a user_data
+ * as global_data; returning false requests a stop. Callbacks must not
+ * add or remove subscribers. Subscribers belong to this instance:
+ * copies of it start without any.
+ *
+ * @param kb_signal The callback.
+ * @param user_data Passed to the callback.
+ * @param cutoff_level Deepest stack for which the callback is invoked.
+ * @param granularity Minimum advance of the total progress.
+ * @param interval_ms Minimum time between two signals; 0 for none.
+ * @return the id to use with removeSubscriber (); 0 if @a kb_signal is NULL
+ */
+int Progress::addSubscriber (
+        KbSignal kb_signal, void * user_data, int cutoff_level,
+        int64_t granularity, int interval_ms)
+{
+    PRGR_TRACE_ENTRY;
+    int id = 0;
+    for (;;) {
+        if (kb_signal == NULL) {
+            PRGR_DEBUG ("  a subscriber needs a callback\n");
+            break;
+        }
+
+        Subscriber s;
+        s.id_ = next_subscriber_id_++;
+        s.kb_signal_ = kb_signal;
+        s.user_data_ = user_data;
+        s.cutoff_level_ = cutoff_level;
+        s.granularity_ = granularity;
+        s.interval_ns_ = interval_ms > 0 ? (int64_t)interval_ms * 1000000 : 0;
+        s.prev_prog_ = prev_prog_;
+        // the first change is never held back by the interval
+        s.prev_ns_ = -s.interval_ns_;
+        if ((s.interval_ns_ > 0) && !clock_.isValid ()) {
+            clock_.start ();
+        }
+        subscribers_.append (s);
+        updateSubscriberGates ();
+
+        id = s.id_;
+        break;
+    }
+    PRGR_TRACE_EXIT;
+    return id;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param id The value returned by addSubscriber ().
+ * @return false if there is no such subscriber
+ */
+bool Progress::removeSubscriber (int id)
+{
+    PRGR_TRACE_ENTRY;
+    bool b_ret = false;
+    for (int i = 0; i < subscribers_.size (); ++i) {
+        if (subscribers_.at (i).id_ == id) {
+            subscribers_.removeAt (i);
+            updateSubscriberGates ();
+            b_ret = true;
+            break;
+        }
+    }
+    PRGR_TRACE_EXIT;
+    return b_ret;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void Progress::recordSetting (RecordedSetting kind, int64_t value)
+{
+    ProgressRecorder::Scope rec_scope (recorder_);
+    if (!rec_scope.active ()) return;
+
+    switch (kind) {
+    case SET_CUTOFF:
+        recorder_->record (ProgressRecorder::OP_CUTOFF, value);
+        break;
+    case SET_GRANULARITY:
+        recorder_->record (ProgressRecorder::OP_GRANULARITY, value);
+        break;
+    case SET_STOP:
+        recorder_->record (value != 0 ?
+                               ProgressRecorder::OP_STOP :
+                               ProgressRecorder::OP_RESET_STOP);
+        break;
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void Progress::startPortion (Portion & p)
+{
+    if (histogram_ == NULL) {
+        p.label_id_ = -1;
+        p.started_ns_ = 0;
+    } else {
+        p.label_id_ = histogram_->intern (p.current_status_);
+        p.started_ns_ = clock_.nsecsElapsed ();
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * @param b_resolved true if the progress was computed, false to
+ *                   only update counters, depth and stop state
+ * @param total_progress the total reported to the callbacks
+ * @param progress the resolved progress
+ */
+void Progress::publishSnapshot (
+        bool b_resolved, int64_t total_progress, int64_t progress)
+{
+    if (snapshot_ == NULL) return;
+
+    ProgressSnapshot::Values & v = snapshot_->beginUpdate ();
+    if (b_resolved) {
+        v.total_ = total_progress;
+        v.progress_ = progress;
+    }
+    v.depth_ = stack_.size ();
+    v.emitted_ = signals_emitted_;
+    v.suppressed_ = signals_suppressed_;
+    v.b_should_stop_ = b_should_stop_;
+    snapshot_->endUpdate ();
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The snapshot is written again once the root advanced by granularity()
+ * units; at this depth that is the given number of units of the top
+ * portion (an estimate for streams, whose total only grows).
+ *
+ * @param top_progress the progress of the top portion that was published
+ * @param top_scale units of the root in a unit of the top portion
+ */
+void Progress::snapshotGate (int64_t top_progress, double top_scale)
+{
+    double span = top_scale > 0.0 ? granularity_ / top_scale : INT64_MAX;
+    if (span < 1.0) {
+        snapshot_next_ = top_progress + 1;
+    } else if (span >= (double)(INT64_MAX - top_progress)) {
+        snapshot_next_ = INT64_MAX;
+    } else {
+        snapshot_next_ = top_progress + (int64_t)ceil (span);
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+void Progress::publishLabel ()
+{
+    if (snapshot_ == NULL) return;
+    snapshot_->publishLabel (current_status_);
+}
+/* ========================================================================= */
+
 /* ------------------------------------------------------------------------- */
 QString Progress::searchCurrentLabel()
 {
@@ -472,14 +976,150 @@ QString Progress::searchCurrentLabel()
 }
 /* ========================================================================= */
 
+/* ------------------------------------------------------------------------- */
+/**
+ * Up to the estimate the portion fills half of its size in parent; past
+ * the estimate each doubling of the progress halves the remaining gap.
+ * The result is continuous, never reaches the size in parent and,
+ * as the estimate may only grow, it is clamped to the highest
+ * value reported so far to keep the progress monotone.
+ *
+ * @param p The streaming portion.
+ * @param in_portion The progress inside the portion.
+ * @return the value in parent's units
+ */
+int64_t Progress::streamShare (Portion & p, int64_t in_portion)
+{
+    int64_t estimate = p.tot_size_ > 0 ? p.tot_size_ : 1;
+    int64_t share;
+    if (in_portion <= 0) {
+        share = 0;
+    } else if (in_portion <= estimate) {
+        share = (in_portion * p.size_in_parent_) / (2 * estimate);
+    } else {
+        share = p.size_in_parent_ -
+                (estimate * p.size_in_parent_) / (2 * in_portion);
+    }
+
+    if ((p.size_in_parent_ > 0) && (share >= p.size_in_parent_)) {
+        share = p.size_in_parent_ - 1;
+    }
+
+    if (share < p.stream_mark_) {
+        share = p.stream_mark_;
+    } else {
+        p.stream_mark_ = share;
+    }
+
+    return p.offset_in_parent_ + share;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+int64_t Progress::subscriberGate (const Subscriber & s)
+{
+    if ((s.granularity_ > 0) && (s.prev_prog_ > INT64_MAX - s.granularity_)) {
+        return INT64_MAX;
+    }
+    return s.prev_prog_ + s.granularity_;
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * Subscribers whose cutoff level rules out the current depth do not
+ * take part in subscriber_next_; they would otherwise keep it at their
+ * last value and make each change walk the list.
+ */
+void Progress::updateSubscriberGates ()
+{
+    const int depth = stack_.size ();
+    subscriber_cutoff_ = 0;
+    subscriber_next_ = INT64_MAX;
+    subscriber_depth_ = depth;
+    foreach (const Subscriber & s, subscribers_) {
+        subscriber_cutoff_ = qMax (subscriber_cutoff_, s.cutoff_level_);
+        if (depth <= s.cutoff_level_) {
+            subscriber_next_ = qMin (subscriber_next_, subscriberGate (s));
+        }
+    }
+}
+/* ========================================================================= */
+
+/* ------------------------------------------------------------------------- */
+/**
+ * The clock is read at most once, and only if a subscriber that
+ * has an interval passed its other filters.
+ *
+ * @param total_progress the total reported to the callbacks
+ * @param progress the resolved progress
+ * @param b_bypass_checks signal all subscribers
+ * @return the number of subscribers that were signaled
+ */
+int Progress::signalSubscribers (
+        int64_t total_progress, int64_t progress, bool b_bypass_checks)
+{
+    const int depth = stack_.size ();
+    void * level_data = stack_.first ().user_data_;
+    int64_t now_ns = -1;
+    int delivered = 0;
+    int64_t next = INT64_MAX;
+
+    QList<Subscriber>::iterator i_end = subscribers_.end ();
+    for (QList<Subscriber>::iterator i = subscribers_.begin (); i != i_end; ++i) {
+        Subscriber & s = *i;
+        bool b_signal = b_bypass_checks || (
+                    (depth <= s.cutoff_level_) &&
+                    (progress - s.prev_prog_ >= s.granularity_));
+        if (b_signal && (s.interval_ns_ > 0)) {
+            if (now_ns < 0) now_ns = clock_.nsecsElapsed ();
+            b_signal = b_bypass_checks || (now_ns - s.prev_ns_ >= s.interval_ns_);
+        }
+
+        if (b_signal) {
+            s.prev_prog_ = progress;
+            s.prev_ns_ = now_ns;
+            if (!s.kb_signal_ (
+                        total_progress,
+                        progress,
+                        current_status_,
+                        level_data,
+                        s.user_data_)) {
+                b_should_stop_ = true;
+            }
+            ++delivered;
+        }
+        if (depth <= s.cutoff_level_) {
+            next = qMin (next, subscriberGate (s));
+        }
+    }
+    subscriber_next_ = next;
+    subscriber_depth_ = depth;
+
+    V_PRGR_DEBUG ("  %d of %d subscribers signaled\n",
+                  delivered, subscribers_.size ());
+    return delivered;
+}
+/* ========================================================================= */
+
 /* ------------------------------------------------------------------------- */
 void Progress::signalChange (bool b_bypass_checks)
 {
     PRGR_TRACE_ENTRY;
     for (;;) {
-        if (!b_bypass_checks && (stack_.size () > cutoff_level_)) {
+        // the widest cutoff decides if the progress is computed at all;
+        // an attached snapshot has a gate of its own, at any depth
+        bool b_main = ((kb_simple_signal_ != NULL) || (kb_full_signal_ != NULL)) &&
+                (b_bypass_checks || (stack_.size () <= cutoff_level_));
+        bool b_subscribers = !subscribers_.isEmpty () && (
+                    b_bypass_checks || (stack_.size () <= subscriber_cutoff_));
+        bool b_snapshot = (snapshot_ != NULL) && (
+                    b_bypass_checks || b_should_stop_ || stack_.isEmpty () ||
+                    (stack_.first ().progress_ >= snapshot_next_));
+        if (!b_main && !b_subscribers && !b_snapshot) {
             V_PRGR_DEBUG (" drop signal (size %" PRIi64 " > cutoff %" PRIi64 ")",
                               stack_.size (), cutoff_level_);
+            ++signals_suppressed_;
             break;
         }
 
@@ -489,14 +1129,26 @@ void Progress::signalChange (bool b_bypass_checks)
         int64_t in_parent = f.progress_;
         int64_t total_progress = 0;
         int i_level = 0;
+        // units of the root in a unit of the top portion
+        double top_scale = 1.0;
 
-        foreach (const Portion & p, stack_) {
+        QList<Portion>::iterator i_end = stack_.end ();
+        for (QList<Portion>::iterator i = stack_.begin (); i != i_end; ++i) {
+            Portion & p = *i;
             int64_t updated_value;
-            total_progress = p.tot_size_;
-            updated_value =
-                    p.offset_in_parent_ +
-                    (in_parent * p.size_in_parent_) /
-                    total_progress;
+            if ((snapshot_ != NULL) && (p.tot_size_ > 0)) {
+                top_scale = top_scale * p.size_in_parent_ / p.tot_size_;
+            }
+            if (p.b_stream_) {
+                total_progress = p.size_in_parent_;
+                updated_value = streamShare (p, in_parent);
+            } else {
+                total_progress = p.tot_size_;
+                updated_value =
+                        p.offset_in_parent_ +
+                        (in_parent * p.size_in_parent_) /
+                        total_progress;
+            }
 
             V_PRGR_DEBUG ("    at level %d progress is %" PRIi64 " out of %" PRIi64 "\n",
                               i_level, in_parent, total_progress);
@@ -508,32 +1160,65 @@ void Progress::signalChange (bool b_bypass_checks)
         V_PRGR_DEBUG ("  new progress is %" PRIi64 ", old one is %" PRIi64 "\n",
                           in_parent, prev_prog_);
 
+        int delivered = 0;
+
+        // calls made by the callbacks are recorded as calls of their own
+        ProgressRecorder::Reentry rec_reentry (recorder_);
+
         // compute the difference and see if is above the threshold
-        if (!b_bypass_checks) {
+        if (b_main && !b_bypass_checks) {
             int64_t difference = in_parent - prev_prog_;
             if (difference < granularity_) {
-                V_PRGR_DEBUG ("  dropping update because of granularity rule\n");
-                break;
+                V_PRGR_DEBUG ("  no callback because of granularity rule\n");
+                b_main = false;
             }
         }
-        prev_prog_ = in_parent;
+        if (b_main) {
+            prev_prog_ = in_parent;
+
+            // callbacks return false to request a stop
+            if (kb_simple_signal_ != NULL) {
+                if (!kb_simple_signal_ (total_progress, in_parent)) {
+                    b_should_stop_ = true;
+                }
+                ++delivered;
+            }
 
-        if (kb_simple_signal_ != NULL) {
-            b_should_stop_ = b_should_stop_ &
-                    kb_simple_signal_ (total_progress, in_parent);
+            if (kb_full_signal_ != NULL) {
+                if (!kb_full_signal_ (
+                            total_progress,
+                            in_parent,
+                            current_status_,
+                            f.user_data_,
+                            user_data_)) {
+                    b_should_stop_ = true;
+                }
+                ++delivered;
+            }
         }
 
-        if (kb_full_signal_ != NULL) {
-            b_should_stop_ = b_should_stop_ &
-                    kb_full_signal_ (
-                        total_progress,
-                        in_parent,
-                        current_status_,
-                        f.user_data_,
-                        user_data_);
+        // a single compare keeps the subscribers out of most steps;
+        // the gate only covers the subscribers that want this depth
+        if (b_subscribers && (subscriber_depth_ != stack_.size ())) {
+            updateSubscriberGates ();
+        }
+        if (b_subscribers && (b_bypass_checks || (in_parent >= subscriber_next_))) {
+            delivered += signalSubscribers (
+                        total_progress, in_parent, b_bypass_checks);
         }
         V_PRGR_DEBUG ("  b_should_stop_ = %s\n", b_should_stop_ ? "true" : "false");
 
+        if (delivered == 0) {
+            V_PRGR_DEBUG ("  dropping update because of granularity rule\n");
+            ++signals_suppressed_;
+        } else {
+            signals_emitted_ += delivered;
+        }
+        if ((snapshot_ != NULL) && (b_snapshot || b_should_stop_)) {
+            publishSnapshot (true, total_progress, in_parent);
+            snapshotGate (f.progress_, top_scale);
+        }
+
         break;
     }
 
@@ -7,6 +7,10 @@ set (PROGRESS_DEBUG_MSG OFF)
 # pileInclude() from pile_support.cmake module.
 include(pile_support)
 
+# the exporter and the remote classes are optional
+option (PROGRESS_WITH_NETWORK
+    "Build ProgressExporter and the remote classes (needs QtNetwork)" OFF)
+
 # initialize this module
 macro    (progressInit
           ref_cnt_use_mode)
@@ -18,12 +22,35 @@ macro    (progressInit
 
     # compose the list of headers and sources
     set(PROGRESS_HEADERS
-        "progress.h")
+        "progress.h"
+        "progress-multi.h"
+        "progress-snapshot.h"
+        "progress-histogram.h"
+        "progress-parallel.h"
+        "progress-trace.h"
+        "progress-bridge.h")
     set(PROGRESS_SOURCES
-        "progress.cc")
+        "progress.cc"
+        "progress-snapshot.cc"
+        "progress-histogram.cc"
+        "progress-parallel.cc"
+        "progress-trace.cc"
+        "progress-bridge.cc")
     set(PROGRESS_QT_MODS
         "Core")
 
+    # the parts that talk over sockets need QtNetwork
+    if (PROGRESS_WITH_NETWORK)
+        list(APPEND PROGRESS_HEADERS
+            "progress-exporter.h"
+            "progress-remote.h")
+        list(APPEND PROGRESS_SOURCES
+            "progress-exporter.cc"
+            "progress-remote.cc")
+        set(PROGRESS_QT_MODS
+            "Core;Network")
+    endif ()
+
     pileSetSources(
         "${PROGRESS_INIT_NAME}"
         "${PROGRESS_HEADERS}"
@@ -11,10 +11,16 @@
 #define GUARD_PROGRESS_H_INCLUDE
 
 #include <progress/progress-config.h>
+#include <QElapsedTimer>
 #include <QList>
 #include <QString>
+#include <limits.h>
 #include <stdint.h>
 
+class ProgressHistogram;
+class ProgressRecorder;
+class ProgressSnapshot;
+
 //! Report progress.
 class PROGRESS_EXPORT Progress {
     //
@@ -39,9 +45,19 @@ class PROGRESS_EXPORT Progress {
         void * user_data_;
 
         QString current_status_;
+
+        // cppcheck-suppress unusedStructMember
+        bool b_stream_; /**< tot_size_ is only a lower bound estimate */
+        // cppcheck-suppress unusedStructMember
+        int64_t stream_mark_; /**< highest share reported to the parent */
+
+        // cppcheck-suppress unusedStructMember
+        int label_id_; /**< interned label (see ProgressHistogram) or -1 */
+        // cppcheck-suppress unusedStructMember
+        int64_t started_ns_; /**< when the portion was created (clock_) */
     };
 
-    //! Callback used for signaling progress.
+    //! Callback used for signaling progress; return false to request a stop.
     typedef bool (*KbSignal) (
             int64_t total_size,
             int64_t progress,
@@ -49,11 +65,23 @@ class PROGRESS_EXPORT Progress {
             void * level_data,
             void * global_data);
 
-    //! Simple callback used for signaling progress.
+    //! Simple callback used for signaling progress; return false to request a stop.
     typedef bool (*KbSignalSimple) (
             int64_t total_size,
             int64_t progress);
 
+    //! A callback that has filters of its own (see addSubscriber ()).
+    struct Subscriber {
+        int id_;
+        KbSignal kb_signal_;
+        void * user_data_; /**< passed as global_data to the callback */
+        int cutoff_level_;
+        int64_t granularity_;
+        int64_t interval_ns_; /**< minimum time between signals; 0 for none */
+        int64_t prev_prog_; /**< value at last signal */
+        int64_t prev_ns_; /**< time of last signal (clock_) */
+    };
+
 public:
 
     /*  DEFINITIONS    ===================================================== */
@@ -80,6 +108,23 @@ private:
     KbSignalSimple kb_simple_signal_;
     KbSignal kb_full_signal_;
 
+    QList<Subscriber> subscribers_; /**< callbacks with their own filters */
+    int subscriber_cutoff_; /**< largest cutoff level of the subscribers */
+    int64_t subscriber_next_; /**< smallest value that may signal a subscriber */
+    int subscriber_depth_; /**< depth that subscriber_next_ was computed for */
+    int next_subscriber_id_;
+
+    int64_t signals_emitted_; /**< number of signals delivered */
+    int64_t signals_suppressed_; /**< changes that were delivered to no one */
+
+    ProgressSnapshot * snapshot_; /**< published state (may be NULL) */
+    int64_t snapshot_next_; /**< progress of the top portion that refreshes the snapshot */
+
+    ProgressHistogram * histogram_; /**< portion durations (may be NULL) */
+    QElapsedTimer clock_; /**< time base for started_ns_ */
+
+    ProgressRecorder * recorder_; /**< trace of the calls (may be NULL) */
+
     /*  DATA    ============================================================ */
     //
     //
@@ -97,7 +142,21 @@ public:
     virtual
     ~Progress ();
 
-    //! assignment operator
+    //! Copy constructor; the copy has no snapshot, recorder or subscribers.
+    Progress (const Progress & other) :
+        subscribers_(),
+        subscriber_cutoff_(0),
+        subscriber_next_(INT64_MAX),
+        subscriber_depth_(-1),
+        next_subscriber_id_(1),
+        snapshot_(NULL),
+        snapshot_next_(INT64_MIN),
+        recorder_(NULL)
+    {
+        *this = other;
+    }
+
+    //! assignment operator; keeps own snapshot, recorder and subscribers
     Progress& operator=( const Progress& other) {
         stack_ = other.stack_;
         cutoff_level_ = other.cutoff_level_;
@@ -108,6 +167,16 @@ public:
         user_data_ = other.user_data_;
         kb_simple_signal_ = other.kb_simple_signal_;
         kb_full_signal_ = other.kb_full_signal_;
+        // a subscriber (such as ProgressBridge) removes itself from the
+        // instance it was added to; subscribers_ is not copied
+        subscriber_depth_ = -1;
+        signals_emitted_ = other.signals_emitted_;
+        signals_suppressed_ = other.signals_suppressed_;
+        // each snapshot has a single writer; snapshot_ is not copied
+        snapshot_next_ = INT64_MIN;
+        histogram_ = other.histogram_;
+        clock_ = other.clock_;
+        // a trace describes a single instance; recorder_ is not copied
         return *this;
     }
 
@@ -139,6 +208,34 @@ public:
             void * portion_data = NULL);
 
 
+    //! Prepares the progress for a run of unknown or growing size.
+    bool
+    initStream (
+            const QString & title = QString (),
+            int64_t scale = 100,
+            int64_t estimate = 0);
+
+    //! Enters a new portion of unknown or growing size.
+    void
+    enterStream (
+            int64_t parent_size,
+            const QString &label = QString (),
+            int64_t estimate = 0,
+            int64_t parent_offset = -1,
+            void * portion_data = NULL);
+
+    //! Raise the estimated size of the nearest streaming portion.
+    void
+    growStream (
+            int64_t at_least);
+
+    //! Tell if the top portion is a streaming one.
+    inline bool
+    isStream () const {
+        return isInitialized () && stack_.first ().b_stream_;
+    }
+
+
     //! Ends current portion; calls end() if this is the last one.
     void
     finish (
@@ -162,6 +259,7 @@ public:
     inline void
     setCutoffLevel (
             int value) {
+        if (recorder_ != NULL) recordSetting (SET_CUTOFF, value);
         cutoff_level_ = value;
     }
 
@@ -175,7 +273,9 @@ public:
     //! Emit signals when progress advances by at least this much.
     inline void
     setGranularity (int64_t value) {
+        if (recorder_ != NULL) recordSetting (SET_GRANULARITY, value);
         granularity_ = value;
+        snapshot_next_ = INT64_MIN;
     }
 
 
@@ -218,6 +318,76 @@ public:
     }
 
 
+    //! Add a callback with its own cutoff level, granularity and interval.
+    int
+    addSubscriber (
+            KbSignal kb_signal,
+            void * user_data = NULL,
+            int cutoff_level = INT_MAX,
+            int64_t granularity = 1,
+            int interval_ms = 0);
+
+    //! Remove a callback added by addSubscriber().
+    bool
+    removeSubscriber (
+            int id);
+
+    //! Number of callbacks added by addSubscriber().
+    inline int
+    subscriberCount () const {
+        return subscribers_.size ();
+    }
+
+
+    //! Number of callbacks invoked (each subscriber counts separately).
+    inline int64_t
+    signalsEmitted () const {
+        return signals_emitted_;
+    }
+
+    //! Number of changes that were not delivered to any callback.
+    inline int64_t
+    signalsSuppressed () const {
+        return signals_suppressed_;
+    }
+
+
+    //! Snapshot where the state is published (see ProgressSnapshot).
+    inline ProgressSnapshot *
+    snapshot () const {
+        return snapshot_;
+    }
+
+    //! Snapshot where the state is published (see ProgressSnapshot).
+    void
+    setSnapshot (
+            ProgressSnapshot * value);
+
+
+    //! Aggregator for the duration of the portions.
+    inline ProgressHistogram *
+    histogram () const {
+        return histogram_;
+    }
+
+    //! Aggregator for the duration of the portions.
+    void
+    setHistogram (
+            ProgressHistogram * value);
+
+
+    //! Recorder for the calls made to this instance.
+    inline ProgressRecorder *
+    recorder () const {
+        return recorder_;
+    }
+
+    //! Recorder for the calls made to this instance.
+    void
+    setRecorder (
+            ProgressRecorder * value);
+
+
     //! Perform a step in the context of top portion.
     bool
     step (
@@ -227,12 +397,14 @@ public:
     //! Sets the internal state to signal the process should terminate.
     inline void
     setStop () {
+        if (recorder_ != NULL) recordSetting (SET_STOP, 1);
         b_should_stop_ = true;
     }
 
     //! Resets the internal state to signal the process should terminate.
     inline void
     resetStop () {
+        if (recorder_ != NULL) recordSetting (SET_STOP, 0);
         b_should_stop_ = false;
     }
 
@@ -243,11 +415,11 @@ public:
     }
 
     //! Force emmit a signal bypassing all checks (granularity, stack).
-    inline bool
+    bool
     emitSigal ();
 
     //! Set characteristics for current level.
-    inline void
+    void
     setLevelCharact (
             int64_t total_size,
             int64_t progress = 0);
@@ -255,10 +427,77 @@ public:
 
 private:
 
+    //! Settings changed by inline methods that are recorded.
+    enum RecordedSetting {
+        SET_CUTOFF,
+        SET_GRANULARITY,
+        SET_STOP
+    };
+
+    //! Records a change made by an inline method.
+    void
+    recordSetting (
+            RecordedSetting kind,
+            int64_t value);
+
+    //! Creates a new portion; common part of enter() and enterStream().
+    void
+    enterPortion (
+            int64_t parent_size,
+            const QString &label,
+            int64_t total_size,
+            int64_t parent_offset,
+            void * portion_data,
+            bool b_stream);
+
     //! Starts from the bottom of the list and searches for a label.
     QString
     searchCurrentLabel ();
 
+    //! Maps the progress of a streaming portion into its parent.
+    static int64_t
+    streamShare (
+            Portion & p,
+            int64_t in_portion);
+
+    //! Prepares the timing fields of a new portion.
+    void
+    startPortion (
+            Portion & p);
+
+    //! Writes the numeric state into the snapshot.
+    void
+    publishSnapshot (
+            bool b_resolved,
+            int64_t total_progress = 0,
+            int64_t progress = 0);
+
+    //! Computes the progress of the top portion that refreshes the snapshot.
+    void
+    snapshotGate (
+            int64_t top_progress,
+            double top_scale);
+
+    //! Writes the current label into the snapshot.
+    void
+    publishLabel ();
+
+    //! Smallest value that may signal this subscriber.
+    static int64_t
+    subscriberGate (
+            const Subscriber & s);
+
+    //! Recomputes the cutoff level and value that gate the subscribers.
+    void
+    updateSubscriberGates ();
+
+    //! Signals the subscribers whose filters accept the change.
+    int
+    signalSubscribers (
+            int64_t total_progress,
+            int64_t progress,
+            bool b_bypass_checks);
+
     //! Signals a change in the progress.
     void
     signalChange (
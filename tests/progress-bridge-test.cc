@@ -0,0 +1,146 @@
+/**
+ * @file progress-bridge-test.cc
+ * @brief Tests for the ProgressBridge class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-bridge.h"
+#include <QAtomicInt>
+#include <QThread>
+#include <QtTest>
+
+//! Steps a Progress instance in a tight loop until it is asked to stop.
+class StepThread : public QThread {
+public:
+    StepThread (Progress * progress, int steps) :
+        progress_(progress),
+        steps_(steps),
+        done_(0)
+    {}
+
+    //! Number of steps performed; valid after the thread finished.
+    int
+    done () const {
+        return done_;
+    }
+
+protected:
+    void run () {
+        for (int i = 0; i < steps_; ++i) {
+            if (!progress_->step ()) break;
+            ++done_;
+        }
+    }
+
+private:
+    Progress * progress_;
+    int steps_;
+    int done_;
+};
+
+//! Records what the bridge delivers in the main thread.
+class Receiver : public QObject {
+    Q_OBJECT
+
+public:
+    Receiver (ProgressBridge * bridge, bool b_cancel) :
+        bridge_(bridge),
+        b_cancel_(b_cancel),
+        delivered_(0),
+        max_pending_(0),
+        last_progress_(-1),
+        b_wrong_thread_(false)
+    {}
+
+    ProgressBridge * bridge_;
+    bool b_cancel_;
+    int64_t delivered_;
+    int64_t max_pending_;
+    qint64 last_progress_;
+    QString last_status_;
+    bool b_wrong_thread_;
+
+public slots:
+    void progressChanged (qint64 total, qint64 progress) {
+        Q_UNUSED(total);
+        ++delivered_;
+        // events posted but not yet delivered, including a new one
+        // that the worker may have posted after this one was taken
+        max_pending_ = qMax (max_pending_,
+                             bridge_->eventsPosted () - delivered_);
+        last_progress_ = progress;
+        if (QThread::currentThread () != thread ()) b_wrong_thread_ = true;
+        if (b_cancel_) bridge_->cancel ();
+    }
+
+    void statusChanged (const QString & status) {
+        last_status_ = status;
+    }
+};
+
+class ProgressBridgeTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void coalescesUpdates () {
+        const int steps = 200000;
+        Progress p;
+        QVERIFY(p.init ("job", steps));
+        ProgressBridge bridge;
+        Receiver receiver (&bridge, false);
+        connect (&bridge, SIGNAL(progressChanged(qint64,qint64)),
+                 &receiver, SLOT(progressChanged(qint64,qint64)));
+        connect (&bridge, SIGNAL(statusChanged(QString)),
+                 &receiver, SLOT(statusChanged(QString)));
+        bridge.attach (&p);
+
+        StepThread worker (&p, steps);
+        worker.start ();
+        QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished (), 30000);
+        QCOMPARE(worker.done (), steps);
+
+        // drain the last event
+        QTRY_COMPARE(receiver.delivered_, bridge.eventsPosted ());
+        QCOMPARE(bridge.updatesReceived (), (int64_t)steps);
+        QVERIFY(bridge.eventsPosted () > 0);
+        QVERIFY(bridge.eventsPosted () * 10 < bridge.updatesReceived ());
+        QVERIFY(receiver.max_pending_ <= 1);
+        QVERIFY(!receiver.b_wrong_thread_);
+
+        // the latest values win
+        QCOMPARE(receiver.last_progress_, (qint64)steps);
+        QCOMPARE(receiver.last_status_, QString ("job"));
+        QVERIFY(bridge.lastLatency () >= 0);
+        QVERIFY(bridge.lastLatency () < (int64_t)10000000000LL);
+        bridge.detach ();
+    }
+
+    void cancelStopsTheWorker () {
+        const int steps = 2000000000;
+        Progress p;
+        QVERIFY(p.init ("job", steps));
+        ProgressBridge bridge;
+        Receiver receiver (&bridge, true);
+        connect (&bridge, SIGNAL(progressChanged(qint64,qint64)),
+                 &receiver, SLOT(progressChanged(qint64,qint64)));
+        bridge.attach (&p);
+
+        StepThread worker (&p, steps);
+        worker.start ();
+        QTRY_VERIFY_WITH_TIMEOUT(worker.isFinished (), 30000);
+        QVERIFY(bridge.isCanceled ());
+        QVERIFY(p.shouldStop ());
+        QVERIFY(worker.done () < steps);
+        QVERIFY(receiver.delivered_ >= 1);
+        bridge.detach ();
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressBridgeTest)
+#include "progress-bridge-test.moc"
@@ -0,0 +1,80 @@
+/**
+ * @file progress-callback-test.cc
+ * @brief Tests for the callbacks of the Progress class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include <QtTest>
+
+//! The value returned by the callbacks.
+static bool b_continue;
+static int signal_count;
+
+static bool simpleSignal (int64_t, int64_t)
+{
+    ++signal_count;
+    return b_continue;
+}
+
+static bool fullSignal (
+        int64_t, int64_t, const QString &, void *, void *)
+{
+    ++signal_count;
+    return b_continue;
+}
+
+class ProgressCallbackTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void init () {
+        b_continue = true;
+        signal_count = 0;
+    }
+
+    void simpleCallbackRequestsStop () {
+        Progress p;
+        p.setSimpleCallback (simpleSignal);
+        QVERIFY(p.init ("job", 100));
+        QVERIFY(p.step ());
+        QVERIFY(!p.shouldStop ());
+
+        b_continue = false;
+        QVERIFY(!p.step ());
+        QVERIFY(p.shouldStop ());
+
+        // a later true does not cancel the request
+        b_continue = true;
+        QVERIFY(!p.step ());
+        QVERIFY(p.shouldStop ());
+    }
+
+    void fullCallbackRequestsStop () {
+        Progress p;
+        p.setCallback (fullSignal);
+        QVERIFY(p.init ("job", 100));
+        b_continue = false;
+        QVERIFY(!p.step ());
+        QVERIFY(p.shouldStop ());
+        QCOMPARE(signal_count, 1);
+    }
+
+    void callbackDoesNotClearStop () {
+        Progress p;
+        p.setSimpleCallback (simpleSignal);
+        QVERIFY(p.init ("job", 100));
+        p.setStop ();
+        b_continue = false;
+        p.step ();
+        QVERIFY(p.shouldStop ());
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressCallbackTest)
+#include "progress-callback-test.moc"
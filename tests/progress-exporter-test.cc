@@ -0,0 +1,88 @@
+/**
+ * @file progress-exporter-test.cc
+ * @brief Tests for the ProgressExporter class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-exporter.h"
+#include <QLocalSocket>
+#include <QtTest>
+
+class ProgressExporterTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void scrapeShowsResolvedProgress () {
+        ProgressExporter exporter;
+        Progress p;
+        p.setCutoffLevel (1);
+        QVERIFY(exporter.addProgress (&p, "job"));
+        QVERIFY(!exporter.addProgress (&p, "job"));
+        QVERIFY(p.init ("job", 100));
+        p.enter (50, "part", 10);
+        p.step (4);
+
+        QByteArray out = exporter.scrape ();
+        QVERIFY(out.contains ("progress_value{name=\"job\"} 20\n"));
+        QVERIFY(out.contains ("progress_total{name=\"job\"} 100\n"));
+        QVERIFY(out.contains ("progress_depth{name=\"job\"} 2\n"));
+        QVERIFY(out.endsWith ("# EOF\n"));
+    }
+
+    void destroyedInstanceIsDropped () {
+        ProgressExporter exporter;
+        Progress * kept = new Progress ();
+        Progress * gone = new Progress ();
+        QVERIFY(exporter.addProgress (kept, "kept"));
+        QVERIFY(exporter.addProgress (gone, "gone"));
+        kept->init ("kept", 10);
+        gone->init ("gone", 10);
+        delete gone;
+
+        QByteArray out = exporter.scrape ();
+        QVERIFY(out.contains ("name=\"kept\""));
+        QVERIFY(!out.contains ("name=\"gone\""));
+
+        // neither call may touch the dead instance
+        exporter.removeProgress (gone);
+        exporter.removeProgress (kept);
+        QVERIFY(kept->snapshot () != NULL);
+        delete kept;
+    }
+
+    void exporterMayGoFirst () {
+        Progress p;
+        {
+            ProgressExporter exporter;
+            QVERIFY(exporter.addProgress (&p, "job"));
+        }
+        QVERIFY(p.init ("job", 10));
+        QVERIFY(p.step (5));
+    }
+
+    void servesLocalSocket () {
+        const QString name ("progress-exporter-test");
+        ProgressExporter exporter;
+        Progress p;
+        QVERIFY(exporter.listenLocal (name));
+        QVERIFY(exporter.addProgress (&p, "job"));
+        QVERIFY(p.init ("job", 100));
+        p.step (42);
+
+        QLocalSocket client;
+        client.connectToServer (name);
+        QByteArray received;
+        QTRY_VERIFY((received += client.readAll ()).contains ("# EOF\n"));
+        QVERIFY(received.contains ("progress_value{name=\"job\"} 42\n"));
+        exporter.close ();
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressExporterTest)
+#include "progress-exporter-test.moc"
@@ -0,0 +1,137 @@
+/**
+ * @file progress-histogram-test.cc
+ * @brief Tests for the ProgressHistogram class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-histogram.h"
+#include <QThread>
+#include <QtTest>
+
+//! Records a fixed duration from its own thread.
+class RecordingThread : public QThread {
+public:
+    RecordingThread (ProgressHistogram * histogram, int64_t elapsed_ns) :
+        histogram_(histogram),
+        elapsed_ns_(elapsed_ns)
+    {}
+
+protected:
+    void run () {
+        int id = histogram_->intern ("shared");
+        for (int i = 0; i < 100; ++i) {
+            histogram_->record (id, elapsed_ns_);
+        }
+    }
+
+private:
+    ProgressHistogram * histogram_;
+    int64_t elapsed_ns_;
+};
+
+//! Find the statistics for a label.
+static ProgressHistogram::Stats statsFor (
+        const ProgressHistogram & histogram, const QString & label)
+{
+    foreach (const ProgressHistogram::Stats & st, histogram.statistics ()) {
+        if (st.label_ == label) return st;
+    }
+    ProgressHistogram::Stats none;
+    none.label_ = label;
+    none.count_ = 0;
+    none.total_ns_ = none.p50_ns_ = none.p99_ns_ = none.max_ns_ = -1;
+    return none;
+}
+
+class ProgressHistogramTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void bucketsAreLogLinear () {
+        for (int64_t v = 0; v < ProgressHistogram::SUB_BUCKETS; ++v) {
+            QCOMPARE(ProgressHistogram::bucketIndex (v), (int)v);
+        }
+        const int64_t values[] = {
+            16, 17, 31, 32, 33, 1000, 123456789, INT64_MAX };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+            int64_t v = values[i];
+            int index = ProgressHistogram::bucketIndex (v);
+            QVERIFY(index < ProgressHistogram::BUCKETS);
+            int64_t highest = ProgressHistogram::bucketHighest (index);
+            QVERIFY(highest >= v);
+            // the error is at most 1/SUB_BUCKETS of the value
+            QVERIFY(highest - v <= v / ProgressHistogram::SUB_BUCKETS);
+            QCOMPARE(ProgressHistogram::bucketIndex (highest), index);
+        }
+    }
+
+    void percentilesFollowTheRanks () {
+        ProgressHistogram histogram;
+        QCOMPARE(histogram.intern (QString ()), -1);
+        int id = histogram.intern ("load");
+        QCOMPARE(histogram.intern ("load"), id);
+        for (int64_t v = 1; v <= 100; ++v) {
+            histogram.record (id, v * 1000);
+        }
+
+        ProgressHistogram::Stats st = statsFor (histogram, "load");
+        QCOMPARE(st.count_, (int64_t)100);
+        QCOMPARE(st.total_ns_, (int64_t)5050000);
+        QCOMPARE(st.max_ns_, (int64_t)100000);
+        QVERIFY(st.p50_ns_ >= 50000);
+        QVERIFY(st.p50_ns_ <= 50000 + 50000 / ProgressHistogram::SUB_BUCKETS);
+        QVERIFY(st.p99_ns_ >= 99000);
+        QVERIFY(st.p99_ns_ <= st.max_ns_);
+
+        histogram.reset ();
+        QVERIFY(histogram.statistics ().isEmpty ());
+        QCOMPARE(histogram.intern ("load"), id);
+    }
+
+    void shardsAreMerged () {
+        ProgressHistogram histogram;
+        RecordingThread a (&histogram, 10);
+        RecordingThread b (&histogram, 12);
+        a.start ();
+        b.start ();
+        a.wait ();
+        b.wait ();
+
+        ProgressHistogram::Stats st = statsFor (histogram, "shared");
+        QCOMPARE(st.count_, (int64_t)200);
+        QCOMPARE(st.total_ns_, (int64_t)2200);
+        QCOMPARE(st.p50_ns_, (int64_t)10);
+        QCOMPARE(st.max_ns_, (int64_t)12);
+    }
+
+    void progressRecordsLabelledPortions () {
+        ProgressHistogram histogram;
+        Progress p;
+        p.setHistogram (&histogram);
+        QVERIFY(p.init ("job", 100));
+        for (int i = 0; i < 3; ++i) {
+            p.enter (10, "part", 10);
+            p.step (10);
+            p.finish ();
+        }
+        // no label of its own
+        p.enter (10, QString (), 10);
+        p.finish ();
+        // the root portion
+        p.finish ();
+
+        QCOMPARE(statsFor (histogram, "part").count_, (int64_t)3);
+        QCOMPARE(statsFor (histogram, "job").count_, (int64_t)1);
+        QCOMPARE(histogram.statistics ().size (), 2);
+        QVERIFY(histogram.report ().startsWith ("job count=1"));
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressHistogramTest)
+#include "progress-histogram-test.moc"
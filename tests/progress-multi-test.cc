@@ -0,0 +1,102 @@
+/**
+ * @file progress-multi-test.cc
+ * @brief Tests for the ProgressMulti class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress-multi.h"
+#include <QtTest>
+
+//! Values received by the last callback.
+static int64_t last_total[2];
+static int64_t last_progress[2];
+static int signal_count;
+static bool b_continue;
+
+static bool collect (
+        const int64_t * total_size, const int64_t * progress,
+        const QString &, void *, void *)
+{
+    for (int k = 0; k < 2; ++k) {
+        last_total[k] = total_size[k];
+        last_progress[k] = progress[k];
+    }
+    ++signal_count;
+    return b_continue;
+}
+
+class ProgressMultiTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void init () {
+        last_progress[0] = last_progress[1] = -1;
+        signal_count = 0;
+        b_continue = true;
+    }
+
+    void metricsScaleIndependently () {
+        const int64_t root[2] = { 1000, 100 };
+        const int64_t share[2] = { 100, 50 };
+        const int64_t size[2] = { 10, 10 };
+        ProgressMulti<2> p;
+        p.setCallback (collect);
+        QVERIFY(p.init ("job", root));
+        p.enter (share, "part", size);
+
+        const int64_t chunk[2] = { 5, 2 };
+        QVERIFY(p.step (chunk));
+        QCOMPARE(last_total[0], (int64_t)1000);
+        QCOMPARE(last_total[1], (int64_t)100);
+        // 10% of the bytes and 50% of the records of the parent
+        QCOMPARE(last_progress[0], (int64_t)50);
+        QCOMPARE(last_progress[1], (int64_t)10);
+
+        p.finish ();
+        QCOMPARE(last_progress[0], (int64_t)100);
+        QCOMPARE(last_progress[1], (int64_t)50);
+    }
+
+    void singleMetricStep () {
+        const int64_t root[2] = { 100, 100 };
+        ProgressMulti<2> p;
+        p.setCallback (collect);
+        QVERIFY(p.init ("job", root));
+        QVERIFY(p.step (1, 7));
+        QCOMPARE(last_progress[0], (int64_t)0);
+        QCOMPARE(last_progress[1], (int64_t)7);
+        QVERIFY(!p.step (2, 1));
+    }
+
+    void granularityIsPerMetric () {
+        const int64_t root[2] = { 100, 100 };
+        ProgressMulti<2> p;
+        p.setCallback (collect);
+        p.setGranularity (0, 10);
+        p.setGranularity (1, 10);
+        QVERIFY(p.init ("job", root));
+        for (int i = 0; i < 9; ++i) p.step (0, 1);
+        QCOMPARE(signal_count, 0);
+        p.step (1, 10);
+        QCOMPARE(signal_count, 1);
+        QCOMPARE(last_progress[0], (int64_t)9);
+    }
+
+    void callbackCanStop () {
+        const int64_t root[2] = { 100, 100 };
+        ProgressMulti<2> p;
+        p.setCallback (collect);
+        QVERIFY(p.init ("job", root));
+        b_continue = false;
+        QVERIFY(!p.step (0, 1));
+        QVERIFY(p.shouldStop ());
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressMultiTest)
+#include "progress-multi-test.moc"
@@ -0,0 +1,159 @@
+/**
+ * @file progress-parallel-test.cc
+ * @brief Tests for the ProgressParallel class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-parallel.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtTest>
+
+enum { ITEMS = 3000 };
+
+//! Number of times each item was processed.
+static QVector<QAtomicInt> * hits;
+//! The body returns false once this item was processed (-1 for never).
+static int64_t stop_at;
+//! Last progress seen by the callback.
+static int64_t last_progress;
+//! The callback returns false once the progress reaches this value.
+static int64_t cancel_at;
+
+//! State of the test where the caller has to wait for the workers.
+enum { WAIT_ITEMS = 60 };
+static QThread * caller_thread;
+static QAtomicInt blocked;
+static QAtomicInt released;
+
+static bool countItems (int64_t begin, int64_t end, void *)
+{
+    for (int64_t i = begin; i < end; ++i) {
+        (*hits)[(int)i].fetchAndAddOrdered (1);
+    }
+    return (stop_at < begin) || (stop_at >= end);
+}
+
+static bool collect (int64_t, int64_t progress)
+{
+    last_progress = progress;
+    return progress < cancel_at;
+}
+
+//! The first item taken by a worker blocks until released by the callback.
+static bool blockOneItem (int64_t begin, int64_t end, void *)
+{
+    if (QThread::currentThread () == caller_thread) {
+        // give the workers time to start
+        QThread::msleep ((unsigned long)(end - begin));
+        return true;
+    }
+    if (blocked.testAndSetOrdered (0, 1)) {
+        QElapsedTimer timer;
+        timer.start ();
+        while (released.fetchAndAddOrdered (0) == 0) {
+            if (timer.nsecsElapsed () > 2000000000LL) break;
+            QThread::usleep (100);
+        }
+    } else {
+        // slow enough to still be running when the caller is out of work
+        QThread::msleep (200 * (unsigned long)(end - begin));
+    }
+    return true;
+}
+
+static bool releaseOnLastButOne (int64_t, int64_t progress)
+{
+    if (progress >= WAIT_ITEMS - 1) {
+        released.fetchAndStoreOrdered (1);
+    }
+    return true;
+}
+
+class ProgressParallelTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void init () {
+        hits = new QVector<QAtomicInt> (ITEMS);
+        stop_at = -1;
+        last_progress = -1;
+        cancel_at = ITEMS + 1;
+        blocked.fetchAndStoreOrdered (0);
+        released.fetchAndStoreOrdered (0);
+        QThreadPool * pool = QThreadPool::globalInstance ();
+        pool->setMaxThreadCount (qMax (pool->maxThreadCount (), 4));
+    }
+
+    void cleanup () {
+        delete hits;
+        hits = NULL;
+    }
+
+    void processesEachItemOnce () {
+        for (int threads = 1; threads <= 4; ++threads) {
+            for (int i = 0; i < ITEMS; ++i) (*hits)[i].fetchAndStoreOrdered (0);
+            Progress p;
+            p.setSimpleCallback (collect);
+            QVERIFY(p.init ("job", ITEMS));
+            ProgressParallel loop (countItems);
+            loop.setThreadCount (threads);
+            QVERIFY(loop.run (p, 0, ITEMS));
+            QCOMPARE(last_progress, (int64_t)ITEMS);
+            for (int i = 0; i < ITEMS; ++i) {
+                QCOMPARE((*hits)[i].fetchAndAddOrdered (0), 1);
+            }
+        }
+    }
+
+    void bodyCanStop () {
+        stop_at = 10;
+        Progress p;
+        QVERIFY(p.init ("job", ITEMS));
+        ProgressParallel loop (countItems);
+        loop.setThreadCount (2);
+        QVERIFY(!loop.run (p, 0, ITEMS));
+        QCOMPARE((*hits)[10].fetchAndAddOrdered (0), 1);
+    }
+
+    void callbackCanStop () {
+        cancel_at = ITEMS / 10;
+        Progress p;
+        p.setSimpleCallback (collect);
+        QVERIFY(p.init ("job", ITEMS));
+        ProgressParallel loop (countItems);
+        // the workers could finish all items before the callback runs
+        loop.setThreadCount (1);
+        QVERIFY(!loop.run (p, 0, ITEMS));
+        QVERIFY(p.shouldStop ());
+        QVERIFY(last_progress < ITEMS);
+    }
+
+    void callerReportsWhileWaiting () {
+        caller_thread = QThread::currentThread ();
+        Progress p;
+        p.setSimpleCallback (releaseOnLastButOne);
+        QVERIFY(p.init ("job", WAIT_ITEMS));
+        ProgressParallel loop (blockOneItem);
+        loop.setThreadCount (3);
+
+        QElapsedTimer timer;
+        timer.start ();
+        QVERIFY(loop.run (p, 0, WAIT_ITEMS));
+        // the item was released by a report, not by the time-out
+        QCOMPARE(released.fetchAndAddOrdered (0), 1);
+        QVERIFY(timer.nsecsElapsed () < 1000000000LL);
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressParallelTest)
+#include "progress-parallel-test.moc"
@@ -0,0 +1,105 @@
+/**
+ * @file progress-remote-test.cc
+ * @brief Tests for the ProgressCoordinator and ProgressWorkerLink classes
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-remote.h"
+#include <limits.h>
+#include <QtTest>
+
+static bool ignore (int64_t, int64_t)
+{
+    return true;
+}
+
+class ProgressRemoteTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void linkUsesInstanceFilters () {
+        Progress w;
+        w.setSimpleCallback (ignore);
+        w.setGranularity (5);
+        QVERIFY(w.init ("worker", 10));
+        ProgressWorkerLink link;
+        link.attach (&w);
+        for (int i = 0; i < 10; ++i) w.step ();
+        // the callback and the link are signaled at 5 and at 10
+        QCOMPARE(w.signalsEmitted (), (int64_t)4);
+    }
+
+    void linkUsesGivenFilters () {
+        Progress w;
+        w.setSimpleCallback (ignore);
+        w.setGranularity (5);
+        QVERIFY(w.init ("worker", 10));
+        ProgressWorkerLink link;
+        link.attach (&w, INT_MAX, 1);
+        for (int i = 0; i < 10; ++i) w.step ();
+        QCOMPARE(w.signalsEmitted (), (int64_t)12);
+    }
+
+    void sharesAreAggregated () {
+        const QString name ("progress-remote-test-shares");
+        Progress c;
+        QVERIFY(c.init ("job", 100));
+        ProgressCoordinator coordinator (&c);
+        QVERIFY(coordinator.listenLocal (name));
+        coordinator.assign (1, 40);
+        coordinator.assign (2, 60);
+
+        Progress w1;
+        QVERIFY(w1.init ("one", 10));
+        ProgressWorkerLink link1;
+        link1.setFlushInterval (0);
+        QVERIFY(link1.connectLocal (name, 1));
+        link1.attach (&w1);
+
+        Progress w2;
+        QVERIFY(w2.init ("two", 4));
+        ProgressWorkerLink link2;
+        link2.setFlushInterval (0);
+        QVERIFY(link2.connectLocal (name, 2));
+        link2.attach (&w2);
+
+        w1.step (5);
+        w2.step (4);
+        QTRY_COMPARE(coordinator.workerShare (1), (int64_t)20);
+        QTRY_COMPARE(coordinator.workerShare (2), (int64_t)60);
+        QCOMPARE(coordinator.connectedCount (), 2);
+    }
+
+    void localStopReachesSilentWorkers () {
+        const QString name ("progress-remote-test-stop");
+        Progress c;
+        QVERIFY(c.init ("job", 100));
+        ProgressCoordinator coordinator (&c);
+        coordinator.setStopPollInterval (10);
+        QCOMPARE(coordinator.stopPollInterval (), 10);
+        QVERIFY(coordinator.listenLocal (name));
+        coordinator.assign (1, 100);
+
+        Progress w;
+        QVERIFY(w.init ("worker", 10));
+        ProgressWorkerLink link;
+        QVERIFY(link.connectLocal (name, 1));
+        link.attach (&w);
+        QTRY_COMPARE(coordinator.connectedCount (), 1);
+
+        // no data arrives after this point
+        c.setStop ();
+        QTRY_VERIFY((link.flush (), link.stopReceived ()));
+        QVERIFY(w.shouldStop ());
+        QCOMPARE(coordinator.stopPollInterval (), 0);
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressRemoteTest)
+#include "progress-remote-test.moc"
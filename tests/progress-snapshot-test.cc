@@ -0,0 +1,155 @@
+/**
+ * @file progress-snapshot-test.cc
+ * @brief Tests for the state that Progress publishes in a ProgressSnapshot
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-snapshot.h"
+#include "progress-trace.h"
+#include <QtTest>
+
+class ProgressSnapshotTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void publishesResolvedState () {
+        ProgressSnapshot snapshot;
+        {
+            Progress p;
+            p.setSnapshot (&snapshot);
+            QVERIFY(p.init ("job", 100));
+            p.enter (50, "part", 10);
+            p.step (4);
+
+            ProgressSnapshot::Values v;
+            snapshot.read (v);
+            QCOMPARE(v.total_, (int64_t)100);
+            QCOMPARE(v.progress_, (int64_t)20);
+            QCOMPARE(v.depth_, 2);
+            QCOMPARE(QString::fromUtf8 (v.label_), QString ("part"));
+            QVERIFY(!v.b_should_stop_);
+            p.setSnapshot (NULL);
+        }
+    }
+
+    void resolvesPastTheCutoff () {
+        ProgressSnapshot snapshot;
+        {
+            Progress p;
+            p.setCutoffLevel (1);
+            p.setSnapshot (&snapshot);
+            QVERIFY(p.init ("job", 100));
+            p.enter (50, "part", 10);
+            p.step (4);
+
+            ProgressSnapshot::Values v;
+            snapshot.read (v);
+            QCOMPARE(v.depth_, 2);
+            QCOMPARE(v.progress_, (int64_t)20);
+            QVERIFY(v.suppressed_ > 0);
+            p.setSnapshot (NULL);
+        }
+    }
+
+    void publishesUnderTheGranularity () {
+        ProgressSnapshot snapshot;
+        {
+            Progress p;
+            p.setCutoffLevel (1);
+            p.setGranularity (5);
+            p.setSnapshot (&snapshot);
+            QVERIFY(p.init ("job", 100));
+            // 100 steps of the portion advance the root by 5
+            p.enter (50, "part", 1000);
+
+            ProgressSnapshot::Values v;
+            for (int i = 0; i < 99; ++i) p.step ();
+            snapshot.read (v);
+            QCOMPARE(v.depth_, 2);
+            QCOMPARE(v.progress_, (int64_t)0);
+
+            p.step ();
+            snapshot.read (v);
+            QCOMPARE(v.progress_, (int64_t)5);
+
+            // finishing the portion publishes at once
+            p.step (7);
+            p.finish ();
+            snapshot.read (v);
+            QCOMPARE(v.depth_, 1);
+            QCOMPARE(v.progress_, (int64_t)50);
+            p.setSnapshot (NULL);
+        }
+    }
+
+    void instanceHoldsAReference () {
+        ProgressSnapshot * snapshot = new ProgressSnapshot ();
+        {
+            Progress p;
+            p.setSnapshot (snapshot);
+            QVERIFY(snapshot->hasWriter ());
+            QVERIFY(p.init ("job", 100));
+            p.step (30);
+
+            // the reader goes away first
+            ProgressSnapshot::release (snapshot);
+            p.step (10);
+            QCOMPARE(p.snapshot (), snapshot);
+        }
+
+        // the writer goes away first
+        snapshot = new ProgressSnapshot ();
+        {
+            Progress p;
+            p.setSnapshot (snapshot);
+            QVERIFY(p.init ("job", 100));
+            p.step (30);
+        }
+        QVERIFY(!snapshot->hasWriter ());
+        ProgressSnapshot::Values v;
+        snapshot->read (v);
+        QCOMPARE(v.progress_, (int64_t)30);
+        ProgressSnapshot::release (snapshot);
+    }
+
+    void copiesDoNotShareSnapshotOrRecorder () {
+        ProgressSnapshot snapshot;
+        ProgressRecorder recorder;
+        {
+            Progress a;
+            a.setSnapshot (&snapshot);
+            a.setRecorder (&recorder);
+            QVERIFY(a.init ("job", 100));
+            a.step (10);
+            int trace_size = recorder.data ().size ();
+
+            Progress b (a);
+            QVERIFY(b.snapshot () == NULL);
+            QVERIFY(b.recorder () == NULL);
+            b.step (50);
+
+            Progress c;
+            c = a;
+            QVERIFY(c.snapshot () == NULL);
+            QVERIFY(c.recorder () == NULL);
+            c.step (70);
+
+            ProgressSnapshot::Values v;
+            snapshot.read (v);
+            QCOMPARE(v.progress_, (int64_t)10);
+            QCOMPARE(recorder.data ().size (), trace_size);
+
+            a.setSnapshot (NULL);
+            a.setRecorder (NULL);
+        }
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressSnapshotTest)
+#include "progress-snapshot-test.moc"
@@ -0,0 +1,94 @@
+/**
+ * @file progress-stream-test.cc
+ * @brief Tests for the streaming portions of the Progress class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include <QList>
+#include <QtTest>
+
+//! Values received by the callback.
+static QList<qint64> reported;
+
+static bool collect (int64_t total_size, int64_t progress)
+{
+    Q_UNUSED(total_size);
+    reported.append (progress);
+    return true;
+}
+
+class ProgressStreamTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void init () {
+        reported.clear ();
+    }
+
+    void shareIsMonotoneAndBounded () {
+        Progress p;
+        p.setSimpleCallback (collect);
+        QVERIFY(p.initStream ("walk", 1000, 0));
+        QVERIFY(p.isStream ());
+        for (int i = 1; i <= 500; ++i) {
+            if ((i % 10) == 0) p.growStream (i + 20);
+            QVERIFY(p.step ());
+        }
+        QVERIFY(!reported.isEmpty ());
+        for (int i = 1; i < reported.size (); ++i) {
+            QVERIFY(reported.at (i) >= reported.at (i - 1));
+        }
+        QVERIFY(reported.last () > 0);
+        QVERIFY(reported.last () < 1000);
+    }
+
+    void finishReportsTheWholeShare () {
+        Progress p;
+        p.setSimpleCallback (collect);
+        QVERIFY(p.init ("job", 1000));
+        p.enterStream (500, "stream", 10);
+        for (int i = 0; i < 50; ++i) p.step ();
+        QVERIFY(reported.last () < 500);
+        p.finish ();
+        QCOMPARE(reported.last (), (qint64)500);
+    }
+
+    void growStreamReachesParentOfActiveChild () {
+        Progress p;
+        p.setSimpleCallback (collect);
+        QVERIFY(p.init ("job", 1000));
+        p.enterStream (1000, "walk", 4);
+        p.enter (1, "item", 10);
+        QVERIFY(!p.isStream ());
+        p.growStream (20);
+        p.step (10);
+        // one item out of 20 estimated fills 1/40 of the stream
+        QCOMPARE(reported.last (), (qint64)25);
+    }
+
+    void enterStreamInitializesRootAtOffsetZero () {
+        Progress p;
+        p.setSimpleCallback (collect);
+        p.enterStream (100, "stream", 10);
+        QVERIFY(p.isInitialized ());
+        p.step (10);
+        QCOMPARE(reported.last (), (qint64)50);
+    }
+
+    void enterInitializesRootAtOffsetZero () {
+        Progress p;
+        p.setSimpleCallback (collect);
+        p.enter (100, "job", 100);
+        p.step (50);
+        QCOMPARE(reported.last (), (qint64)50);
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressStreamTest)
+#include "progress-stream-test.moc"
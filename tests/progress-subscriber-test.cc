@@ -0,0 +1,158 @@
+/**
+ * @file progress-subscriber-test.cc
+ * @brief Tests for the subscribers of the Progress class
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include <QList>
+#include <QtTest>
+
+//! Values received by a subscriber.
+struct Received {
+    QList<qint64> progress_;
+    bool b_continue_;
+};
+
+static bool collect (
+        int64_t, int64_t progress, const QString &, void *, void * user_data)
+{
+    Received * r = static_cast<Received *>(user_data);
+    r->progress_.append (progress);
+    return r->b_continue_;
+}
+
+static bool simpleSignal (int64_t, int64_t)
+{
+    return true;
+}
+
+static bool fullSignal (int64_t, int64_t, const QString &, void *, void *)
+{
+    return true;
+}
+
+class ProgressSubscriberTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void nothingToDeliverWithoutCallbacks () {
+        Progress p;
+        QVERIFY(p.init ("job", 100));
+        for (int i = 0; i < 10; ++i) QVERIFY(p.step ());
+        QCOMPARE(p.signalsEmitted (), (int64_t)0);
+        QCOMPARE(p.signalsSuppressed (), (int64_t)10);
+    }
+
+    void eachCallbackCounts () {
+        Progress p;
+        p.setSimpleCallback (simpleSignal);
+        p.setCallback (fullSignal);
+        QVERIFY(p.init ("job", 100));
+        for (int i = 0; i < 10; ++i) p.step ();
+        QCOMPARE(p.signalsEmitted (), (int64_t)20);
+        QCOMPARE(p.signalsSuppressed (), (int64_t)0);
+    }
+
+    void subscriberAloneCountsItsSignals () {
+        Received r;
+        r.b_continue_ = true;
+        Progress p;
+        QVERIFY(p.init ("job", 100));
+        QVERIFY(p.addSubscriber (collect, &r, INT_MAX, 10) > 0);
+        for (int i = 0; i < 100; ++i) p.step ();
+        QCOMPARE(r.progress_.size (), 10);
+        QCOMPARE(r.progress_.last (), (qint64)100);
+        QCOMPARE(p.signalsEmitted (), (int64_t)10);
+        QCOMPARE(p.signalsSuppressed (), (int64_t)90);
+    }
+
+    void filtersAreIndependent () {
+        Received coarse;
+        coarse.b_continue_ = true;
+        Received shallow;
+        shallow.b_continue_ = true;
+        Progress p;
+        p.setSimpleCallback (simpleSignal);
+        p.setCutoffLevel (0);
+        QVERIFY(p.init ("job", 100));
+        p.addSubscriber (collect, &coarse, INT_MAX, 50);
+        p.addSubscriber (collect, &shallow, 1, 1);
+        p.enter (100, "part", 100);
+        for (int i = 0; i < 100; ++i) p.step ();
+
+        QCOMPARE(coarse.progress_.size (), 2);
+        QCOMPARE(coarse.progress_.at (0), (qint64)50);
+        // the portion is at depth 2
+        QVERIFY(shallow.progress_.isEmpty ());
+        QCOMPARE(p.signalsEmitted (), (int64_t)2);
+
+        // back at depth 1 the gate covers the shallow subscriber again
+        p.finish (false);
+        QVERIFY(shallow.progress_.isEmpty ());
+        p.step (1);
+        QCOMPARE(shallow.progress_.size (), 1);
+        QCOMPARE(shallow.progress_.last (), (qint64)1);
+    }
+
+    void removedSubscriberIsSilent () {
+        Received r;
+        r.b_continue_ = true;
+        Progress p;
+        QVERIFY(p.init ("job", 100));
+        int id = p.addSubscriber (collect, &r);
+        QCOMPARE(p.subscriberCount (), 1);
+        p.step ();
+        p.removeSubscriber (id);
+        QCOMPARE(p.subscriberCount (), 0);
+        p.step ();
+        QCOMPARE(r.progress_.size (), 1);
+    }
+
+    void copiesHaveNoSubscribers () {
+        Received r;
+        r.b_continue_ = true;
+        Received own;
+        own.b_continue_ = true;
+        Progress a;
+        QVERIFY(a.init ("job", 100));
+        a.addSubscriber (collect, &r);
+
+        Progress b (a);
+        QCOMPARE(b.subscriberCount (), 0);
+        b.step (10);
+        QVERIFY(r.progress_.isEmpty ());
+
+        Progress c;
+        QVERIFY(c.init ("other", 100));
+        int id = c.addSubscriber (collect, &own);
+        c = a;
+        QCOMPARE(c.subscriberCount (), 1);
+        c.step (20);
+        QVERIFY(r.progress_.isEmpty ());
+        QCOMPARE(own.progress_.size (), 1);
+        QCOMPARE(own.progress_.last (), (qint64)20);
+        QVERIFY(c.removeSubscriber (id));
+
+        a.step (30);
+        QCOMPARE(r.progress_.size (), 1);
+    }
+
+    void subscriberCanStop () {
+        Received r;
+        r.b_continue_ = false;
+        Progress p;
+        QVERIFY(p.init ("job", 100));
+        p.addSubscriber (collect, &r);
+        QVERIFY(!p.step ());
+        QVERIFY(p.shouldStop ());
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressSubscriberTest)
+#include "progress-subscriber-test.moc"
@@ -0,0 +1,107 @@
+/**
+ * @file progress-trace-test.cc
+ * @brief Tests for the ProgressRecorder and ProgressReplay classes
+ * @author Nicu Tofan <nicu.tofan@gmail.com>
+ * @copyright Copyright 2014 piles contributors. All rights reserved.
+ * This file is released under the
+ * [MIT License](http://opensource.org/licenses/mit-license.html)
+ */
+
+#include "progress.h"
+#include "progress-trace.h"
+#include <QtTest>
+
+//! The instance that the callback stops.
+static Progress * stopped;
+
+//! The replay also signals a full callback.
+static bool ignore (int64_t, int64_t, const QString &, void *, void *)
+{
+    return true;
+}
+
+static bool stopHalfWay (int64_t total_size, int64_t progress)
+{
+    if (progress * 2 >= total_size) {
+        stopped->setStop ();
+    }
+    return true;
+}
+
+class ProgressTraceTest : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void replayMatchesTheRecordedRun () {
+        ProgressRecorder recorder;
+        Progress p;
+        p.setCallback (ignore);
+        p.setCutoffLevel (2);
+        p.setGranularity (5);
+        // the filters set before attaching are part of the trace
+        p.setRecorder (&recorder);
+        QVERIFY(p.init ("job", 100));
+        p.enter (50, "part", 20);
+        for (int i = 0; i < 20; ++i) p.step ();
+        p.finish ();
+        p.enter (50, "deeper", 10);
+        p.enter (10, "deepest", 10);
+        for (int i = 0; i < 10; ++i) p.step ();
+        p.finish ();
+        p.finish ();
+        p.setRecorder (NULL);
+
+        ProgressReplay replay;
+        QVERIFY(replay.load (recorder.data ()));
+        ProgressReplay::Result r = replay.run ();
+        QCOMPARE(r.calls_, (int64_t)replay.callCount ());
+        QCOMPARE(r.signals_emitted_, p.signalsEmitted ());
+        QCOMPARE(r.signals_suppressed_, p.signalsSuppressed ());
+    }
+
+    void nestedCallsAreRecordedOnce () {
+        ProgressRecorder recorder;
+        Progress p;
+        p.setRecorder (&recorder);
+        QVERIFY(p.init ("job", 10));
+        p.step (10);
+        // finishes the root, which ends the instance
+        p.finish ();
+
+        ProgressReplay replay;
+        QVERIFY(replay.load (recorder.data ()));
+        // cutoff, granularity, init, step, finish
+        QCOMPARE(replay.callCount (), 5);
+    }
+
+    void callsFromCallbacksAreRecorded () {
+        ProgressRecorder recorder;
+        Progress p;
+        stopped = &p;
+        p.setSimpleCallback (stopHalfWay);
+        p.setRecorder (&recorder);
+        QVERIFY(p.init ("job", 10));
+        for (int i = 0; i < 5; ++i) p.step ();
+        QVERIFY(p.shouldStop ());
+
+        ProgressReplay replay;
+        QVERIFY(replay.load (recorder.data ()));
+        // cutoff, granularity, init, five steps and the stop
+        QCOMPARE(replay.callCount (), 9);
+    }
+
+    void rejectsMalformedTraces () {
+        ProgressReplay replay;
+        QVERIFY(!replay.load (QByteArray ("PRGX")));
+        QByteArray trace ("PRGT");
+        trace.append ((char)ProgressRecorder::FORMAT_VERSION);
+        trace.append ((char)ProgressRecorder::OP_MAX);
+        QVERIFY(!replay.load (trace));
+        QCOMPARE(replay.callCount (), 0);
+    }
+
+};
+
+QTEST_GUILESS_MAIN(ProgressTraceTest)
+#include "progress-trace-test.moc"